@@ -5,7 +5,8 @@ override TGT = $(eval \
   override TGT:=$$(foreach b,$$(BIN),$$(if $$(strip $$(SRC_$$b)),$$b)))$(TGT)
 
 override A_TGT = $(eval override A_TGT:=$$(filter %.a,$$(TGT)))$(A_TGT)
-override O_TGT = $(eval override O_TGT:=$$(strip $$(TGT:%.a=)))$(O_TGT)
+override S_TGT = $(eval override S_TGT:=$$(filter %.so,$$(TGT)))$(S_TGT)
+override O_TGT = $(eval override O_TGT:=$$(strip $$(filter-out %.so,$$(TGT:%.a=))))$(O_TGT)
 
 .PHONY: all $(TGT)             \
         compile_commands.json  \
@@ -39,6 +40,16 @@ endif
 ifeq (,$(filter -mcpu=% -march=% -mtune=%,$(CFLAGS)))
 override CFLAGS += -march=native -mtune=native
 endif
+# Objects are shared between executables and shared libraries, which
+# only export the symbols that are explicitly marked for it.
+ifneq (,$(S_TGT))
+ifeq (,$(filter -fPIC -fpic -fno-PIC -fno-pic,$(CFLAGS)))
+override CFLAGS += -fPIC
+endif
+ifeq (,$(filter -fvisibility=%,$(CFLAGS)))
+override CFLAGS += -fvisibility=hidden
+endif
+endif
 
 ifeq (,$(filter -flto=% -flto -fno-lto,$(CXXFLAGS)))
 override CXXFLAGS += -flto=auto
@@ -88,7 +99,7 @@ override JSON_$1  := $$(O_OBJ_$1:=.json)
 $1: | $$O$1
 
 ifneq (,$(1:%.a=))
-# Executable target
+# Executable or shared library target
 $$O$1: $$(A_OBJ_$1) $$(O_OBJ_$1) $$(EXT_$1)
 override LDFLAGS_$1 = $$(call pkg-config,libs-only-L,$$(LIB_$1))
 override LDLIBS_$1  = $$(call pkg-config,libs-only-l,$$(LIB_$1))
@@ -157,6 +168,14 @@ $(O_TGT:%=$O%):
 	               $(LDLIBS) $(LDLIBS_$(@F)))
 endif
 
+ifneq (,$(S_TGT))
+$(S_TGT:%=$O%):
+	+$(strip $(CC) -o "$@" -shared $(CFLAGS)     \
+	               -ffile-prefix-map=$(SRCDIR)='' \
+	               $^ $(LDFLAGS) $(LDFLAGS_$(@F)) \
+	               $(LDLIBS) $(LDLIBS_$(@F)))
+endif
+
 ifneq (,$(A_TGT))
 (%): % ;
 $(A_TGT:%=$O%):
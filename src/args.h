@@ -6,12 +6,75 @@
 #ifndef DBS26_SRC_ARGS_H_
 #define DBS26_SRC_ARGS_H_
 
+#include "compat.h"
+
 #include <stdint.h>
 
+#include "order.h"
+
+enum engine {
+	ENGINE_RECURSIVE,
+	ENGINE_ITERATIVE,
+	ENGINE_GENERIC,
+};
+
+enum kernel {
+	KERNEL_AUTO,
+	KERNEL_LOOP,
+	KERNEL_ONEHOT,
+	KERNEL_AVX2,
+	KERNEL_AVX512,
+};
+
+enum format {
+	FORMAT_RAW,
+	FORMAT_PACKED,
+};
+
+enum sink {
+	SINK_STORE,
+	SINK_COUNT,
+	SINK_CHECKSUM,
+};
+
 struct args {
-	uintptr_t   have;
+	uint64_t    have;
 	char const *output;
 	uint32_t    threads;
+	uint32_t    sweep[16];  //!< Thread counts to benchmark
+	uint32_t    sweep_len;
+	uint32_t    repeat;     //!< Benchmark repetitions, 0 for a plain run
+	char const *json;
+	uint32_t    memory;
+	bool        mmap;
+	enum engine engine;
+	enum kernel kernel;
+	uint32_t    order;
+	uint32_t    prefix_len;
+	uint64_t    prefix[SEQ_WORDS_MAX];
+	uint32_t    split_depth;
+	bool        symmetry;
+	enum format format;
+	enum sink   sink;
+	bool        stats;
+	char const *stats_csv;
+	bool        perf;
+	char const *trace;
+	bool        progress;
+	int32_t     status_fd;  //!< Where --progress writes status lines, or -1
+	char const *unpack;
+	char const *query;
+	char const *verify;
+	char const *digest;
+	char const *checkpoint;
+	bool        resume;
+	uint32_t    shard;      //!< From 1, or 0 to do the whole run
+	uint32_t    shards;
+	char const *const *files; //!< Shard files to merge
+	uint32_t    n_files;
+	uint64_t    range[2];
+	uint64_t    sample;
+	uint64_t    seed;
 	int32_t     error;
 };
 
@@ -19,4 +82,12 @@ extern struct args
 args (int    argc,
       char **argv);
 
+/**
+ * @brief Run the program as the command line says, see dbs26.c.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+dbs26_run (struct args const *a);
+
 #endif /* DBS26_SRC_ARGS_H_ */
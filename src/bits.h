@@ -98,6 +98,33 @@ u64_count_lsb_1 (uint64_t x)
 	return_run1(lsb, x);
 }
 
+static force_inline unsigned
+u32_count_ones (uint32_t x)
+{
+#if defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+	return (unsigned)__popcnt(x);
+#elif defined _MSC_VER
+	x -= (x >> 1U) & 0x55555555U;
+	x = (x & 0x33333333U) + ((x >> 2U) & 0x33333333U);
+	x = (x + (x >> 4U)) & 0x0f0f0f0fU;
+	return (unsigned)((x * 0x01010101U) >> 24U);
+#else
+	return (unsigned)__builtin_popcount(x);
+#endif
+}
+
+static force_inline unsigned
+u64_count_ones (uint64_t x)
+{
+#if defined _MSC_VER && defined _M_X64
+	return (unsigned)__popcnt64(x);
+#elif defined _MSC_VER
+	return u32_count_ones((uint32_t)x) + u32_count_ones((uint32_t)(x >> 32U));
+#else
+	return (unsigned)__builtin_popcountll(x);
+#endif
+}
+
 #undef cmpl
 #undef return_run1
 
@@ -124,4 +151,10 @@ u64_count_lsb_1 (uint64_t x)
  ,int32_t:u32_count_lsb_1((uint32_t)(x))\
  ,int64_t:u64_count_lsb_1((uint64_t)(x)))
 
+#define count_ones(x) _Generic((x)      \
+ ,uint32_t:u32_count_ones(x)            \
+ ,uint64_t:u64_count_ones(x)            \
+ ,int32_t:u32_count_ones((uint32_t)(x)) \
+ ,int64_t:u64_count_ones((uint64_t)(x)))
+
 #endif /* DBS26_SRC_BITS_H_ */
@@ -93,4 +93,6 @@ diag_clang(ignored "-Wpre-c11-compat")
 # define const_inline __forceinline
 #endif // _MSC_VER
 
+#define countof(x) (sizeof (x) / sizeof (x)[0])
+
 #endif /* DBS26_SRC_COMPAT_H_ */
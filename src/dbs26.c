@@ -16,12 +16,16 @@
 #include <string.h>
 
 #ifndef _WIN32
+# include <fcntl.h>
 # include <pthread.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
 # include <time.h>
 # include <unistd.h>
 #else
 # include <Windows.h>
 
+# include <direct.h>
 # include <fcntl.h>
 # include <io.h>
 # include <process.h>
@@ -30,6 +34,17 @@
 
 #include "args.h"
 #include "bits.h"
+#include "dbs26.h"
+#include "digest.h"
+#include "leaf.h"
+#include "pack.h"
+#include "perf.h"
+#include "query.h"
+#include "shard.h"
+#include "sym.h"
+#include "sync.h"
+#include "trace.h"
+#include "window.h"
 
 // Wow thanks for letting me know you inlined and/or didn't
 pragma_msvc(warning(disable: 4710))
@@ -42,8 +57,6 @@ pragma_msvc(warning(disable: 5045))
   (unsigned char *)(1 ? (ptr) : &((T *)0)->member) - offsetof(T, member) \
 ))
 
-#define countof(x) (sizeof (x) / sizeof (x)[0])
-
 #define SUB_LEN 6U
 #define SEQ_LEN (1U << SUB_LEN)
 #define SUB_LAST (SEQ_LEN - 1U)
@@ -52,6 +65,17 @@ pragma_msvc(warning(disable: 5045))
 #define SEARCH_SPACE(n) ((1U << n) - n - 2U)
 #define SEARCH_DEPTH(n) (SEARCH_SPACE(n) / n)
 
+/*
+ * The search builds a sequence from its last bit followed by the rest
+ * from the beginning, so a candidate of level 3 holds the first 39 bits
+ * and every window that starts at offset 33 or earlier is known. With
+ * --symmetry, only the sequences that have their all-ones window there
+ * are searched for, and the others are the complements of those with
+ * the all-ones window before offset 64 - 33.
+ */
+#define SYM_LEVEL 3U
+#define SYM_ONES_MAX 33U
+
 #if 0
 static const_inline struct s16 {
 	char d[16U + 1U];
@@ -107,32 +131,157 @@ struct u64_pair {
 	uint64_t map;
 };
 
+/**
+ * @brief Search counters kept with --stats.
+ *
+ * A candidate is valid if it adds no repeated windows to its parent,
+ * and the valid ones on the last level are checked for the windows
+ * that wrap around. @a nodes counts the candidates descended into on
+ * each level, and on the last level the ones that were checked.
+ */
+struct scan_stats {
+	uint64_t nodes[SEARCH_DEPTH(SUB_LEN) - 1U];
+	uint64_t valid;
+	uint64_t invalid;
+	uint64_t found;  //!< Complete sequences
+};
+
+/**
+ * @brief Search state.
+ *
+ * Frame @a i holds the candidates of search level @a i: @a seq is the
+ * one being searched, @a ext has a bit set for each valid one after it
+ * (see scan_ext()), and @a stk[i] holds the last one and the windows
+ * used by their parent. The engines keep the frames from @a top to the
+ * current level up to date whenever they descend, so that the rest of
+ * a level can be split off into a separate piece of work. Candidates
+ * that don't use all of the windows in @a need[i] are skipped.
+ *
+ * The statistics of a level are counted when it's entered, so a piece
+ * split off from it sets @a split to leave its first level uncounted.
+ */
 struct stk {
-	uint32_t        sp;
-	uint32_t        sum;
-	//uint64_t        seq;
-	struct u64_pair stk[SEARCH_DEPTH(SUB_LEN) - 1U];
+	uint32_t                 sp;
+	uint32_t                 top;    //!< Level the search started from
+	bool                     split;  //!< Level @a top is already counted
+	_Atomic(uint32_t) const *hungry; //!< Number of idle workers
+	leaf_func_t             *leaf;   //!< Leaf kernel, or null for the loop
+	bool                     onehot; //!< Branch-free check on the last level
+	uint64_t                 sum;    //!< Checksum of the sequences found
+	struct scan_stats        stats;
+	struct u64_pair          stk[SEARCH_DEPTH(SUB_LEN) - 1U];
+	uint64_t                 seq[SEARCH_DEPTH(SUB_LEN) - 1U];
+	uint64_t                 ext[SEARCH_DEPTH(SUB_LEN) - 1U];
+	uint64_t                 need[SEARCH_DEPTH(SUB_LEN) - 1U];
 };
 
-static uint32_t
-scan (struct stk *stk,
-      uint64_t   *dst,
-      uint64_t    seq,
-      uint64_t    map);
+/*
+ * Each engine is compiled once per sink, with and without counting
+ * statistics, so that the features cost nothing in the search loops
+ * of the variants that don't use them. Columns: function name suffix,
+ * sink, statistics.
+ */
+#define SCAN_VARIANTS(X)                         \
+	X(,             SINK_STORE,    false)    \
+	X(_count,       SINK_COUNT,    false)    \
+	X(_sum,         SINK_CHECKSUM, false)    \
+	X(_stats,       SINK_STORE,    true)     \
+	X(_count_stats, SINK_COUNT,    true)     \
+	X(_sum_stats,   SINK_CHECKSUM, true)
 
-static force_inline uint64_t
-validate_map (uint64_t seq,
-              uint64_t map,
-              uint32_t num)
+#define X(suffix, ...)                                                \
+static uint32_t                                                       \
+scan##suffix (struct stk *stk, uint64_t *dst, uint64_t seq,           \
+              uint64_t map);
+SCAN_VARIANTS(X)
+#undef X
+
+static void
+stk_split (struct stk *stk,
+           uint32_t    sp);
+
+static double
+clock_ms (void);
+
+/**
+ * @brief Get a timestamp for an event, if @a t is recording any.
+ */
+static force_inline double
+trace_clock (struct trace const *const t)
 {
-	for (; !seen(&map, seq & SUB_MASK); seq >>= 1U) {
-		if (!--num)
-			return map;
-	}
+	return t->ev ? clock_ms() : 0.0;
+}
+
+/** @brief Offer work to idle workers, if there are any.
+ *
+ * @param stk Search state.
+ * @param sp  One past the deepest level with an up-to-date frame.
+ */
+static force_inline void
+stk_poll (struct stk *const stk,
+          uint32_t const    sp)
+{
+	if (atomic_load_explicit(stk->hungry, memory_order_relaxed))
+		stk_split(stk, sp);
+}
+
+/** @brief Hash a sequence for the checksum sink.
+ *
+ * The checksum is the sum of the hashes of all sequences, so it doesn't
+ * depend on the order in which the workers find them.
+ */
+static const_inline uint64_t
+sink_hash (uint64_t x)
+{
+	x = (x ^ (x >> 30U)) * UINT64_C(0xbf58476d1ce4e5b9);
+	x = (x ^ (x >> 27U)) * UINT64_C(0x94d049bb133111eb);
+	return x ^ (x >> 31U);
+}
+
+/** @brief Get where the output of a search call goes.
+ *
+ * Only the store sink writes anything, the others leave @a dst as is,
+ * which may then be a null pointer.
+ */
+static const_inline uint64_t *
+sink_at (uint64_t *const  dst,
+         uint32_t const   n,
+         enum sink const  sink)
+{
+	return sink == SINK_STORE ? &dst[n] : dst;
+}
 
+/** @brief Search the children of a candidate with the same variant.
+ */
+static force_inline uint32_t
+scan_sink (struct stk *const stk,
+           uint64_t *const   dst,
+           uint64_t const    seq,
+           uint64_t const    map,
+           enum sink const   sink,
+           bool const        stats)
+{
+#define X(suffix, k, t)                                               \
+	if (sink == k && stats == t)                                  \
+		return scan##suffix(stk, dst, seq, map);
+	SCAN_VARIANTS(X)
+#undef X
 	return 0U;
 }
 
+/** @brief Count the candidates @a seq to @a end that are valid.
+ */
+static force_inline void
+stats_ext (struct stk *const stk,
+           uint64_t const    seq,
+           uint64_t const    end,
+           uint64_t const    ext)
+{
+	uint64_t const n = count_ones(ext);
+	stk->stats.valid += n;
+	stk->stats.invalid += end - seq + 1U - n;
+}
+
 static force_inline uint64_t
 validate_seq (uint64_t seq,
               uint64_t map,
@@ -146,76 +295,311 @@ validate_seq (uint64_t seq,
 	return 0U;
 }
 
+/** @brief Get the valid candidates from @a seq to @a end.
+ *
+ * @param seq First candidate.
+ * @param end Last candidate, which must only differ from @a seq in the
+ *            lowest @ref SUB_LEN bits.
+ * @param map Windows used by the parent of the candidates.
+ * @return    A mask with bit `x` set if the candidate that ends in the
+ *            bits `x` only adds new windows.
+ */
+static force_inline uint64_t
+scan_ext (uint64_t const seq,
+          uint64_t const end,
+          uint64_t const map)
+{
+	return window_ext(seq >> SUB_LEN, map)
+	       & UINT64_MAX << (seq & SUB_MASK)
+	       & ((UINT64_C(2) << (end & SUB_MASK)) - 1U);
+}
+
 static force_inline uint32_t
 scan6 (struct stk      *stk,
        uint64_t *const  dst,
-       uint64_t         seq)
+       uint64_t         seq,
+       enum sink const  sink,
+       bool const       stats)
 {
-	uint64_t const end = stk->stk[stk->sp].end;
-	uint64_t const map = stk->stk[stk->sp].map;
+	uint32_t const sp = stk->sp;
+	uint64_t const map = stk->stk[sp].map;
+	uint64_t ext = scan_ext(seq, stk->stk[sp].end, map);
 	uint32_t n = 0U;
 
-	for (stk->sp++;; seq++) {
-		uint64_t m = validate_map(seq, map, SUB_LEN);
-		if (m) {
-			n += scan(stk, &dst[n], seq, m);
-		}
+	if (stats && !(stk->split && sp == stk->top))
+		stats_ext(stk, seq, stk->stk[sp].end, ext);
 
-		if (end == seq)
-			break;
+	// The candidates are reloaded on every round because stk_poll()
+	// may have split off the rest of this level.
+	seq = seq >> SUB_LEN << SUB_LEN;
+	for (stk->sp++; ext; ext = stk->ext[sp]) {
+		uint64_t const c = seq | count_lsb_1(~ext);
+		uint64_t const m = map | window_bits(c, SUB_LEN);
+		stk->ext[sp] = ext & (ext - 1U);
+		if (stk->need[sp] & ~m)
+			continue;
+		stk->seq[sp] = c;
+		if (stats)
+			stk->stats.nodes[sp]++;
+		stk_poll(stk, sp + 1U);
+		n += scan_sink(stk, sink_at(dst, n, sink), c, m, sink, stats);
 	}
 
 	stk->sp--;
 	return n;
 }
 
+/** @brief Find the complete sequences among the last-level candidates.
+ *
+ * Uses the vectorized kernel picked at startup if there is one, or
+ * else checks the valid candidates from scan_ext() one at a time.
+ * Depending on @a sink, the sequences found are stored in @a dst,
+ * only counted, or hashed into @a stk->sum.
+ *
+ * @param stk  Search state.
+ * @param dst  Output array.
+ * @param seq  First candidate.
+ * @param end  Last candidate.
+ * @param map   Windows used by the parent sequence.
+ * @param sink  What to do with the sequences found.
+ * @param stats Whether to count statistics.
+ * @return      Number of sequences found.
+ */
 static force_inline uint32_t
-scan5 (struct stk const *const stk,
-       uint64_t *const         dst,
-       uint64_t                seq)
+scan_leaf (struct stk *const stk,
+           uint64_t *const   dst,
+           uint64_t          seq,
+           uint64_t const    end,
+           uint64_t const    map,
+           enum sink const   sink,
+           bool const        stats)
 {
-	uint64_t const end = stk->stk[stk->sp].end;
-	uint64_t const map = stk->stk[stk->sp].map;
-	uint32_t n = 0U;
+	if (stats) {
+		uint64_t const ext = scan_ext(seq, end, map);
+		stats_ext(stk, seq, end, ext);
+		stk->stats.nodes[countof(stk->stk) - 1U] += count_ones(ext);
+	}
 
-	for (;; ++seq) {
-		uint64_t m = validate_map(seq, map, SUB_LEN);
-		if (m) {
-			uint64_t q = validate_seq(rol_64(seq, SUB_LEN - 1U),
-			                          m, SUB_LEN - 1U);
-			if (q)
-				dst[n++] = q;
+	if (stk->leaf) {
+		uint32_t k;
+		if (sink == SINK_STORE) {
+			k = stk->leaf(dst, seq, end, map);
+		} else {
+			// The kernels store their results, so keep them in cache
+			uint64_t v[SEQ_LEN];
+			k = stk->leaf(v, seq, end, map);
+			for (uint32_t i = 0U; sink == SINK_CHECKSUM && i < k; ++i)
+				stk->sum += sink_hash(v[i]);
 		}
+		if (stats)
+			stk->stats.found += k;
+		return k;
+	}
 
-		if (end == seq)
-			break;
+	uint32_t n = 0U;
+
+	// Only the windows that wrap around are left to check
+	uint64_t ext = scan_ext(seq, end, map);
+	for (seq = seq >> SUB_LEN << SUB_LEN; ext; ext &= ext - 1U) {
+		uint64_t const c = seq | count_lsb_1(~ext);
+		uint64_t const m = map | window_bits(c, SUB_LEN);
+		uint64_t const r = rol_64(c, SUB_LEN - 1U);
+		if (stk->onehot && sink == SINK_COUNT) {
+			n += (m | window_bits(r, SUB_LEN - 1U)) == UINT64_MAX;
+		} else if (stk->onehot) {
+			if ((m | window_bits(r, SUB_LEN - 1U)) == UINT64_MAX) {
+				if (sink == SINK_STORE)
+					dst[n] = rol_64(c, 1U);
+				else
+					stk->sum += sink_hash(rol_64(c, 1U));
+				++n;
+			}
+		} else {
+			uint64_t const q = validate_seq(r, m, SUB_LEN - 1U);
+			if (q && sink == SINK_STORE)
+				dst[n] = q;
+			else if (q && sink == SINK_CHECKSUM)
+				stk->sum += sink_hash(q);
+			n += !!q;
+		}
 	}
 
+	if (stats)
+		stk->stats.found += n;
 	return n;
 }
 
-static uint32_t
-scan (struct stk      *stk,
-      uint64_t *const  dst,
-      uint64_t         seq,
-      uint64_t         map)
+static force_inline uint32_t
+scan5 (struct stk *const stk,
+       uint64_t *const   dst,
+       uint64_t          seq,
+       enum sink const   sink,
+       bool const        stats)
+{
+	return scan_leaf(stk, dst, seq, stk->stk[stk->sp].end,
+	                 stk->stk[stk->sp].map, sink, stats);
+}
+
+/** @brief Search the candidates @a seq to @a end at level @a stk->sp.
+ *
+ * @param stk  Search state.
+ * @param dst  Output array.
+ * @param seq  First candidate.
+ * @param end  Last candidate.
+ * @param map   Windows used by the parent of the candidates.
+ * @param sink  What to do with the sequences found.
+ * @param stats Whether to count statistics.
+ * @return      Number of sequences found.
+ */
+static force_inline uint32_t
+scan_range_sink (struct stk      *stk,
+                 uint64_t *const  dst,
+                 uint64_t         seq,
+                 uint64_t         end,
+                 uint64_t         map,
+                 enum sink const  sink,
+                 bool const       stats)
 {
-	seq <<= SUB_LEN;
-	stk->stk[stk->sp].end = seq + SUB_LAST - count_msb_1(map);
+	stk->stk[stk->sp].end = end;
 	stk->stk[stk->sp].map = map;
-	seq += count_lsb_1(map);
 	return stk->sp < countof(stk->stk) - 1U
-	       ? scan6(stk, dst, seq)
-	       : scan5(stk, dst, seq);
+	       ? scan6(stk, dst, seq, sink, stats)
+	       : scan5(stk, dst, seq, sink, stats);
+}
+
+/** @brief Non-recursive equivalent of scan_range_sink().
+ *
+ * Searches exactly like scan_range_sink() does, but the loop state of
+ * every level lives in @a stk rather than on the call stack. Moving
+ * down or back up a level is a jump within a single loop.
+ */
+static force_inline uint32_t
+scan_iter_sink (struct stk      *stk,
+                uint64_t *const  dst,
+                uint64_t         seq,
+                uint64_t         end,
+                uint64_t         map,
+                enum sink const  sink,
+                bool const       stats)
+{
+	uint32_t const top = stk->sp;
+	uint32_t const leaf = countof(stk->stk) - 1U;
+	uint32_t sp = top;
+	uint32_t n = 0U;
+
+	if (sp == leaf)
+		return scan_leaf(stk, dst, seq, end, map, sink, stats);
+
+	uint64_t ext = scan_ext(seq, end, map);
+	if (stats && !stk->split)
+		stats_ext(stk, seq, end, ext);
+
+	for (;;) {
+		if (ext) {
+			stk->stk[sp].map = map;
+		} else {
+			do {
+				if (sp == top)
+					return n;
+				--sp;
+			} while (!stk->ext[sp]);
+
+			ext = stk->ext[sp];
+			seq = stk->seq[sp];
+		}
+
+		seq = seq >> SUB_LEN << SUB_LEN | count_lsb_1(~ext);
+		stk->ext[sp] = ext & (ext - 1U);
+		stk->seq[sp] = seq;
+		map = stk->stk[sp].map | window_bits(seq, SUB_LEN);
+		if (stk->need[sp++] & ~map) {
+			ext = 0U;
+			continue;
+		}
+		if (stats)
+			stk->stats.nodes[sp - 1U]++;
+		stk_poll(stk, sp);
+
+		seq <<= SUB_LEN;
+		end = seq + SUB_LAST - count_msb_1(map);
+		seq += count_lsb_1(map);
+
+		if (sp < leaf) {
+			ext = scan_ext(seq, end, map);
+			if (stats)
+				stats_ext(stk, seq, end, ext);
+		} else {
+			n += scan_leaf(stk, sink_at(dst, n, sink), seq, end,
+			               map, sink, stats);
+			ext = 0U;
+		}
+	}
+}
+
+typedef uint32_t scan_func_t(struct stk *, uint64_t *, uint64_t, uint64_t,
+                             uint64_t);
+
+#define X(suffix, sink, stats)                                        \
+static uint32_t                                                       \
+scan_range##suffix (struct stk *stk, uint64_t *dst, uint64_t seq,     \
+                    uint64_t end, uint64_t map)                       \
+{                                                                     \
+	return scan_range_sink(stk, dst, seq, end, map, sink, stats); \
+}                                                                     \
+                                                                      \
+static uint32_t                                                       \
+scan##suffix (struct stk *stk, uint64_t *dst, uint64_t seq,           \
+              uint64_t map)                                           \
+{                                                                     \
+	seq <<= SUB_LEN;                                              \
+	return scan_range_sink(stk, dst, seq + count_lsb_1(map),      \
+	                       seq + SUB_LAST - count_msb_1(map),     \
+	                       map, sink, stats);                     \
+}                                                                     \
+                                                                      \
+static uint32_t                                                       \
+scan_iter##suffix (struct stk *stk, uint64_t *dst, uint64_t seq,      \
+                   uint64_t end, uint64_t map)                        \
+{                                                                     \
+	return scan_iter_sink(stk, dst, seq, end, map, sink, stats);  \
 }
+SCAN_VARIANTS(X)
+#undef X
+
+static scan_func_t *const engines[][3][2] = {
+#define X(suffix, sink, stats) [sink][stats] = scan_range##suffix,
+	[ENGINE_RECURSIVE] = { SCAN_VARIANTS(X) },
+#undef X
+#define X(suffix, sink, stats) [sink][stats] = scan_iter##suffix,
+	[ENGINE_ITERATIVE] = { SCAN_VARIANTS(X) },
+#undef X
+};
+
+/** @brief Capacity of the deque of each worker.
+ */
+#define DEQUE_LEN 8U
 
 struct worker {
-	size_t    id;
+	size_t             id;
 #ifndef _WIN32
-	pthread_t tid;
+	pthread_t          tid;
 #else
-	uintptr_t tid;
+	uintptr_t          tid;
 #endif
+	struct stk         stk;
+	struct piece      *piece;            //!< Piece being searched
+	struct piece      *deque[DEQUE_LEN]; //!< Pieces split off by this worker
+	uint32_t           head;             //!< Oldest piece in the deque
+	_Atomic(uint32_t)  queued;           //!< Number of pieces in the deque
+	double             busy;             //!< Time searching, with --stats
+	double             idle;             //!< Time waiting for work
+	uint32_t           pieces;           //!< Pieces searched
+	uint64_t           count;            //!< Sequences found
+	struct perf        perf;             //!< Counters, with --perf
+	struct perf_count  counts;           //!< Counted while searching
+	struct trace       trace;            //!< Events, with --trace
+	struct u64_vec     tmp;              //!< See piece_solve()
+	_Atomic(uint64_t)  found;            //!< Sequences so far, for --progress
 };
 
 #ifndef _WIN32
@@ -353,54 +737,156 @@ static const uint32_t task_seq_count[] = {
 	1114112, 1245184
 };
 
-static const uint64_t task_seq_map[] = {
-	0x000000030001115f, 0x000000030001215f, 0x000000030001419f, 0x000000030001819f,
-	0x0000000500120537, 0x0000000500220537, 0x0000000500420937, 0x0000000500820937,
-	0x0000000901021157, 0x0000000902021157, 0x0000000904022157, 0x0000000908022157,
-	0x0000000910024197, 0x0000000920024197, 0x0000000940028197, 0x0000000980028197,
-	0x0000001300050317, 0x0000001500060317, 0x0000001900060317, 0x0000012100140617,
-	0x0000022100140617, 0x0000042100240617, 0x0000082100240617, 0x0000102100440a17,
-	0x0000202100440a17, 0x0000402100840a17, 0x0000802100840a17, 0x0001004101081217,
-	0x0002004101081217, 0x0004004102081217, 0x0008004102081217, 0x0010004104082217,
-	0x0020004104082217, 0x0040004108082217, 0x0080004108082217, 0x0100008110084217,
-	0x0200008110084217, 0x0400008120084217, 0x0800008120084217, 0x1000008140088217,
-	0x2000008140088217, 0x8000008180088217, 0x000001030011042f, 0x0000010500120437,
-	0x0000010900120467, 0x00000109001204a7, 0x0000021100140527, 0x0000021100140627,
-	0x0000022100140c27, 0x0000024100181427, 0x0000024100182427, 0x0000028100184427,
-	0x0000028100188427, 0x0000050100310427, 0x0000050100320427, 0x0000060100340427,
-	0x0000060100380427, 0x0000180101600427, 0x0000180102600427, 0x0000280104600427,
-	0x0000280108600427, 0x0000480110a00427, 0x0000480120a00427, 0x0000880140a00427,
-	0x0000880180a00427, 0x0001100301400827, 0x0002100501400827, 0x0002100901400827,
-	0x0004101102400827, 0x0004102102400827, 0x0008104102400827, 0x0008108102400827,
-	0x0010210104400827, 0x0010220104400827, 0x0020240104400827, 0x0020280104400827,
-	0x0040300108400827, 0x0080600108400827, 0x0080a00108400827, 0x0101400110800827,
-	0x0102400110800827, 0x0204400110800827, 0x0208400110800827, 0x0410400120800827,
-	0x0420400120800827, 0x0840400120800827, 0x0880400120800827, 0x1100800140800827,
-	0x1200800140800827, 0x2400800140800827, 0x2800800140800827, 0xc000800180800827,
-	0x000100030100105f, 0x000100030100106f, 0x000200050100115b, 0x000200050100125b,
-	0x000200050100146b, 0x000200050100186b, 0x00020009010050cb, 0x00020009010090cb,
-	0x000400110201114b, 0x000400110202114b, 0x000400110204124b, 0x000400110208124b,
-	0x000400210210144b, 0x000400210220144b, 0x000400210240184b, 0x000400210280184b,
-	0x000800410600304b, 0x000800410a00304b, 0x000800811200504b, 0x000800812200504b,
-	0x000800814200904b, 0x000800818200904b, 0x001001030401204b, 0x001001050402204b,
-	0x001001090402204b, 0x001002110404204b, 0x001002210404204b, 0x001002410408204b,
-	0x001002810408204b, 0x002005010410204b, 0x002006010410204b, 0x00200c010420204b,
-	0x002018010440204b, 0x002028010440204b, 0x002048010480204b, 0x002088010480204b,
-	0x004110010900204b, 0x004210010900204b, 0x004410010a00204b, 0x004810010a00204b,
-	0x005020010c00204b, 0x006020010c00204b, 0x018040011800204b, 0x028040011800204b,
-	0x048040012800204b, 0x088040012800204b, 0x108080014800204b, 0x208080014800204b,
-	0x808080018800204b, 0x010100031000408f, 0x010200051000409b, 0x01020005100040ab,
-	0x01020009100040cb, 0x020400111000418b, 0x020400111000428b, 0x020400211000448b,
-	0x020400211000488b, 0x020800411000508b, 0x020800411000608b, 0x020800811000c08b,
-	0x041001012001408b, 0x041001012002408b, 0x041002012004408b, 0x041002012008408b,
-	0x042004012010408b, 0x042004012020408b, 0x042008012040408b, 0x042008012080408b,
-	0x084010012100408b, 0x084010012200408b, 0x084020012400408b, 0x084020012800408b,
-	0x088040013000408b, 0x088080016000408b, 0x08808001a000408b, 0x110100034000808b,
-	0x110200054000808b, 0x110200094000808b, 0x120400114000808b, 0x120400214000808b,
-	0x120800414000808b, 0x120800814000808b, 0x241001014000808b, 0x241002014000808b,
-	0x242004014000808b, 0x242008014000808b, 0x284010014000808b, 0x284020014000808b,
-	0x288040014000808b, 0x288080014000808b, 0xd10000018000808b, 0xd20000018000808b,
-	0xe40000018000808b, 0xe80000018000808b
+/**
+ * @brief Find the task table entry for a 16-bit order 6 prefix.
+ *
+ * @return Index into the task tables, or -1 if no sequence begins
+ *         with @a prefix.
+ */
+static int32_t
+task_seq_find (uint16_t prefix)
+{
+	size_t lo = 0U, hi = countof(task_seq_prefix);
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2U;
+		if (task_seq_prefix[mid] < prefix)
+			lo = mid + 1U;
+		else
+			hi = mid;
+	}
+	return lo < countof(task_seq_prefix) && task_seq_prefix[lo] == prefix
+	       ? (int32_t)lo : -1;
+}
+
+/**
+ * @brief A contiguous part of the output of a task.
+ *
+ * Every task starts out as a single piece: the candidates @a seq to
+ * @a end at search level @a sp. While a worker searches a piece, it
+ * can split off the untried candidates of one level into a new piece
+ * for an idle worker to steal. It always picks the shallowest level
+ * that has candidates left, so everything it outputs after the split
+ * precedes the new piece, and everything that was split off earlier
+ * follows it. Inserting each new piece right after the one it came
+ * from therefore keeps the list of pieces in output order.
+ */
+struct piece {
+	struct piece   *next;  //!< Next piece of the same task
+	struct task    *task;
+	struct u64_view out;   //!< Output, once done
+	uint64_t        count; //!< Number of sequences, once done
+	uint64_t        seq;   //!< First candidate
+	uint64_t        end;   //!< Last candidate
+	uint64_t        map;   //!< Windows used by the parent
+	uint32_t        sp;    //!< Search level
+	struct digest   digest; //!< Of the output, once done with --digest
+	int             error; //!< Error code, once done
+	bool            done;
+};
+
+/**
+ * @brief A unit of work: all sequences that begin with a given prefix.
+ */
+struct task {
+	struct node       node;   //!< The prefix to search from
+	struct piece      head;   //!< First piece of the output
+	struct u64_view   sym;    //!< Sequences derived with --symmetry
+	struct pack       pack;   //!< Output encoded with --format packed
+	uint64_t          size;   //!< Number of sequences, or an upper bound
+	uint64_t          end;    //!< Byte offset of the end of this task
+	bool              exact;  //!< Whether @ref size is exact
+	double            ms;     //!< Time spent on its pieces, with --stats
+	uint32_t          pieces;
+	uint64_t          count;  //!< Sequences found
+	struct scan_stats stats;
+	struct perf_count perf;   //!< Counted on its pieces, with --perf
+	struct digest     digest; //!< Of the output, with --digest
+};
+
+/**
+ * @brief Get the prefix of a task in output form, as with --prefix.
+ *
+ * @param t    Task.
+ * @param bits Where to store the prefix length, at most 63 bits.
+ */
+static uint64_t
+task_prefix (struct task const *t,
+             uint32_t          *bits)
+{
+	uint32_t const len = t->node.len - 1U < 63U ? t->node.len - 1U : 63U;
+	*bits = len;
+	return len ? t->node.seq[0] << 1U >> (64U - len) : 0U;
+}
+
+/**
+ * @brief Solver configuration.
+ */
+struct solver_cfg {
+	uint32_t        threads;    //!< Thread count, 0 for all CPUs
+	uint64_t        mem_limit;  //!< See solver_create()
+	enum engine     engine;     //!< Search engine
+	uint32_t        order;      //!< Subsequence length
+	uint32_t        prefix_len; //!< Prefix length in bits
+	uint64_t const *prefix;     //!< Prefix, see node_root()
+	uint32_t        split;      //!< Task prefix length in bits, 0 for auto
+	enum kernel     kernel;     //!< Window check kernel
+	bool            sym;        //!< Search only half, derive the rest
+	enum format     format;     //!< Output format
+	enum sink       sink;       //!< What to do with the sequences
+	bool            stats;      //!< Collect search statistics
+	bool            perf;       //!< Count hardware events
+	bool            trace;      //!< Keep a log of events
+	bool            progress;   //!< Report progress while running
+	bool            digest;     //!< Hash the output of each task
+	char const     *checkpoint; //!< Where to save progress, or null
+	bool            resume;     //!< Go on from a saved checkpoint
+	uint32_t        shard;      //!< Part of the work to do, from 1
+	uint32_t        shards;     //!< Number of parts, 0 to do all of it
+	int             status_fd;  //!< Where to write status lines, or -1
+	bool            verbose;    //!< Print progress information
+};
+
+/**
+ * @brief The leaf kernel behind each --kernel option.
+ */
+static enum leaf_kernel const kernel_leaf[] = {
+	[KERNEL_AUTO]   = LEAF_LOOP,
+	[KERNEL_LOOP]   = LEAF_LOOP,
+	[KERNEL_ONEHOT] = LEAF_LOOP,
+	[KERNEL_AVX2]   = LEAF_AVX2,
+	[KERNEL_AVX512] = LEAF_AVX512,
+};
+
+/**
+ * @brief Cached number of sequences under a search candidate.
+ */
+struct memo {
+	uint64_t seq;   //!< Candidate, 0 if the entry is unused
+	uint64_t count;
+};
+
+// The levels and the number of candidates to cache the counts of
+#define MEMO_LEVELS 2U
+#define MEMO_BITS 17U
+#define MEMO_LEN (1U << MEMO_BITS)
+
+/**
+ * @brief Progress saved with --checkpoint.
+ *
+ * The output file itself keeps the finished tasks. After each task is
+ * written out, the output is synced to disk and then a line with the
+ * end offset and digest of the task is appended to a journal in the
+ * checkpoint directory and synced in turn. A run can be cut short at
+ * any point, and a resumed run cuts the output back to the end of the
+ * last task in the journal and goes on from the next one. A line that
+ * was only partly written when the run ended is left out.
+ */
+struct checkpoint {
+	char const *dir;
+	bool        resume;
+	FILE       *journal;
+	uint32_t    next;    //!< First task that isn't saved
+	uint64_t    offset;  //!< Size of the saved output in bytes
 };
 
 // Silence flexible array member warning
@@ -408,28 +894,183 @@ pragma_msvc(warning(push))
 pragma_msvc(warning(disable: 4200))
 
 struct solver {
-	struct u64_view   tasks[countof(task_seq_count)];
-	_Atomic(int32_t)  task_iter;
+	struct task      *tasks;
+	uint32_t          n_tasks;
+	uint32_t          order;
+	uint32_t          words;
+	struct lock       lock;
+	scan_func_t      *scan;
+	scan_func_t      *count;     //!< Count-only variant of @a scan
+	enum sink         sink;
+	bool              stats;     //!< See solver_stats()
+	struct scan_stats above;     //!< See plan_stats()
+	bool              perf;      //!< See solver_perf()
+	struct perf_count write;     //!< Counted on this thread in solver_run()
+	struct trace      trace;     //!< Events of this thread, see solver_trace()
+	double            epoch;     //!< When solver_run() started
+	bool              progress;  //!< See progress_func()
+	int               status_fd;
+	_Atomic(uint32_t) finished;  //!< Tasks written out so far
+	bool              digest;    //!< See solver_digest()
+	struct checkpoint ckpt;      //!< See checkpoint_open()
+	struct shard      shard;     //!< See solver_shard(), count 0 if none
+	uint64_t         *map;
+	uint64_t          mem_limit;
+	uint64_t          held;      //!< Bytes of output not yet written
+	uint32_t          write_next;
+	uint32_t          task_next;
+	uint32_t          active;    //!< Pieces queued or being searched
+	_Atomic(uint32_t) hungry;    //!< Workers waiting for something to do
+	bool              sym;       //!< See solver_finish()
+	bool              pack;      //!< See solver_finish()
+	dbs26_batch_func *batch;     //!< Output callback, see solver_emit()
+	void             *batch_ctx;
+	struct memo      *memo;      //!< See solver_unrank()
+	uint32_t          memo_len;
+	uint64_t         *scratch;
+	struct sampler   *sampler;   //!< See solver_sample()
+	struct verifier  *verifier;  //!< See solver_verify()
 	uint32_t          n_workers;
 	struct worker     workers[];
 };
 
 pragma_msvc(warning(pop))
 
-static struct u64_view
-task_solve (struct stk *const stk,
-            uint32_t const    id)
+/**
+ * @brief Allocate room for @a len words of the output of task @a id.
+ */
+static uint64_t *
+piece_alloc (struct trace *const trace,
+             uint32_t const      id,
+             size_t const        len)
+{
+	double const t0 = trace_clock(trace);
+	uint64_t *const buf = malloc((len ? len : 1U) * sizeof *buf);
+	trace_add(trace, (struct trace_event){
+		.begin = t0,
+		.end   = trace_clock(trace),
+		.arg   = (len ? len : 1U) * sizeof *buf,
+		.id    = id,
+		.kind  = TRACE_ALLOC,
+	});
+	return buf;
+}
+
+/**
+ * @brief Generate the sequences of a piece.
+ *
+ * @param s     Solver.
+ * @param stk   Search stack.
+ * @param trace Event log of the calling thread.
+ * @param tmp   Buffer of the calling thread for the output of tasks of
+ *              which only an upper bound of the size is known.
+ * @param p     Piece.
+ * @param dst   Where to put the output, or a null pointer to allocate
+ *              a buffer for it.
+ * @param out   Where to store a view of the output. If @a dst was a
+ *              null pointer, the caller owns the buffer. Left empty
+ *              unless the sequences are stored.
+ * @param n     Where to store the number of sequences.
+ * @return      0 on success, otherwise an error code.
+ */
+static int
+piece_solve (struct solver const *const s,
+             struct stk *const          stk,
+             struct trace *const        trace,
+             struct u64_vec *const      tmp,
+             struct piece const *const  p,
+             uint64_t                  *dst,
+             struct u64_view *const     out,
+             uint64_t *const            n)
 {
-	uint64_t *dst = malloc(task_seq_count[id] * sizeof *dst);
-	if (dst) {
-		stk->sp = 0U;
-		uint32_t n = scan(stk, dst, task_seq_prefix[id],
-		                  task_seq_map[id]);
-		if (task_seq_count[id] == n)
-			return u64_view(dst, dst + n);
-		free(dst);
+	struct task const *const t = p->task;
+	uint32_t const id = (uint32_t)(t - s->tasks);
+	size_t const cap = (size_t)t->size * s->words;
+	uint64_t *buf = nullptr;
+	size_t len = 0U;
+
+	*out = u64_view(nullptr, nullptr);
+	if (s->scan && s->sink != SINK_STORE) {
+		stk->sp = stk->top = p->sp;
+		stk->split = p != &t->head;
+		*n = s->scan(stk, nullptr, p->seq, p->end, p->map);
+		return t->size && *n > t->size ? EPROTO : 0;
+	}
+
+	if (s->scan && !dst && !t->exact) {
+		// Deep tasks often hold a small fraction of their bound, so
+		// search into the buffer of the thread, which only grows to
+		// the largest bound, and keep just what was found
+		tmp->len = 0U;
+		if (u64_vec_reserve(tmp, cap ? cap : 1U))
+			return ENOMEM;
+		stk->sp = stk->top = p->sp;
+		stk->split = p != &t->head;
+		len = s->scan(stk, tmp->ptr, p->seq, p->end, p->map);
+		if (len > cap)
+			return EPROTO;
+		buf = piece_alloc(trace, id, len);
+		if (!buf)
+			return ENOMEM;
+		dst = len ? memcpy(buf, tmp->ptr, len * sizeof *buf) : buf;
+	} else if (s->scan) {
+		if (!dst) {
+			buf = piece_alloc(trace, id, cap);
+			if (!buf)
+				return ENOMEM;
+			dst = buf;
+		}
+		stk->sp = stk->top = p->sp;
+		stk->split = p != &t->head;
+		len = s->scan(stk, dst, p->seq, p->end, p->map);
+	} else {
+		struct u64_vec v = {0};
+		int e = order_search(&v, &t->node, s->order);
+		if (!e && dst) {
+			if (v.len <= cap)
+				(void)memcpy(dst, v.ptr, v.len * sizeof *dst);
+			free(v.ptr);
+			v.ptr = nullptr;
+		}
+		if (e) {
+			free(v.ptr);
+			return e;
+		}
+		buf = v.ptr;
+		len = v.len;
+		if (!dst)
+			dst = buf;
+
+		// Nothing to specialize, so count and hash what was stored
+		if (s->sink != SINK_STORE) {
+			*n = len / s->words;
+			for (size_t i = 0U; s->sink == SINK_CHECKSUM && i < len;
+			     i += s->words) {
+				uint64_t h = 0U;
+				for (uint32_t j = 0U; j < s->words; ++j)
+					h = sink_hash(h ^ buf[i + j]);
+				stk->sum += h;
+			}
+			free(buf);
+			return 0;
+		}
+	}
+
+	if (t->size && len > cap) {
+		free(buf);
+		return EPROTO;
+	}
+
+	// Give back what was reserved for the worst case
+	if (buf && len && len < cap) {
+		uint64_t *q = realloc(buf, len * sizeof *q);
+		if (q)
+			dst = buf = q;
 	}
-	return u64_view(nullptr, nullptr);
+
+	*out = u64_view(dst, dst + len);
+	*n = len / s->words;
+	return 0;
 }
 
 static uint32_t
@@ -454,208 +1095,4118 @@ nproc (void)
 	return 1U;
 }
 
-static struct solver *
-solver_create (uint32_t  n_workers,
-               int      *err)
+/**
+ * @brief Replace every node in @a v by its descendants that are @a len
+ *        bits long.
+ *
+ * @return 0 on success, E2BIG if there would be more than @a max nodes,
+ *         or ENOMEM. On failure @a v is left as it was.
+ */
+static int
+node_vec_expand (struct node_vec *v,
+                 uint32_t         n,
+                 uint32_t         len,
+                 size_t           max)
 {
-	if (!n_workers)
-		n_workers = nproc();
-
-	(void)fprintf(stderr, "Using %" PRIu32 " threads\n", n_workers);
+	struct node_vec r = {0};
+	int e = 0;
 
-	struct solver *s = calloc(1U, offsetof(struct solver,
-	                                       workers[n_workers]));
-	if (!s) {
-		if (err)
-			*err = errno ? errno : ENOMEM;
-		return nullptr;
+	for (size_t i = 0U; !e && i < v->len; ++i) {
+		e = node_expand(&r, &v->ptr[i], n, len);
+		if (!e && r.len > max)
+			e = E2BIG;
 	}
 
-	atomic_init(&s->task_iter, -(int32_t)countof(s->tasks));
-
-	s->n_workers = n_workers;
-	for (uint32_t i = 0U; i < n_workers; ++i) {
-		s->workers[i].id = i;
+	if (e) {
+		free(r.ptr);
+	} else {
+		free(v->ptr);
+		*v = r;
 	}
 
-	return s;
+	return e;
 }
 
+// Tasks per shard that --shard splits the work into, at the least
+#define SHARD_TASKS 64U
+
+/**
+ * @brief Keep only the tasks of shard @a index of @a count.
+ *
+ * The task table is cut into @a count runs of tasks that each take
+ * about the same share of the work. The cost of a task is its size as
+ * in the task tables, which for order 6 is the number of sequences or
+ * an upper bound of it, and where the sizes aren't known every task
+ * costs the same. Every shard computes the same table and cuts it at
+ * the same places, so between them they do every task exactly once.
+ *
+ * The run is identified by a hash of the prefixes of all of its tasks,
+ * so that shards of different runs can't be merged.
+ */
 static void
-solver_free_tasks (struct solver *s)
+solver_shard (struct solver  *s,
+              uint32_t const  index,
+              uint32_t const  count)
 {
-	for (size_t i = 0U; i < countof(s->tasks); ++i) {
-		free(s->tasks[i].begin[0]);
-		s->tasks[i] = u64_view(nullptr, nullptr);
+	struct digest run = {0};
+	uint64_t total = 0U;
+	for (uint32_t i = 0U; i < s->n_tasks; ++i) {
+		uint32_t bits = 0U;
+		uint64_t w[2] = {task_prefix(&s->tasks[i], &bits)};
+		w[1] = bits;
+		run = digest_cat(run, digest_words(w, countof(w)));
+		total += s->tasks[i].size ? s->tasks[i].size : 1U;
 	}
-}
 
-static void
-solver_destroy (struct solver **pp)
-{
-	if (pp) {
-		struct solver *s = *pp;
-		*pp = nullptr;
-		if (s) {
-			solver_free_tasks(s);
-			free(s);
+	// Shard k ends where shard k + 1 begins, at the first task that
+	// has at least k / count of the total cost before it
+	uint32_t first = s->n_tasks, end = s->n_tasks;
+	uint64_t cost = 0U;
+	for (uint32_t i = 0U; i < s->n_tasks; ++i) {
+		if (first == s->n_tasks &&
+		    cost * count >= (uint64_t)(index - 1U) * total)
+			first = i;
+		if (cost * count >= (uint64_t)index * total) {
+			end = i;
+			break;
 		}
+		cost += s->tasks[i].size ? s->tasks[i].size : 1U;
 	}
-}
 
-#ifndef _WIN32
-static void *
-#else
-static unsigned __stdcall
-#endif
-worker_func (void *arg)
-{
-	struct stk stk = {0};
-	struct worker *w = arg;
-	struct solver *s = container_of(w, struct solver, workers[w->id]);
-	unsigned count = 0U;
+	s->shard = (struct shard){
+		.run   = run.hash,
+		.order = s->order,
+		.tasks = s->n_tasks,
+		.index = index,
+		.count = count,
+		.first = first,
+		.end   = end,
+	};
 
-	for (int32_t i;
-	     0 > (i = atomic_fetch_add_explicit(&s->task_iter, 1,
-	                                        memory_order_relaxed));)
-	{
-		uint32_t const id = (uint32_t)~i;
-		s->tasks[id] = task_solve(&stk, id);
-		count += u64_view_len(s->tasks[id]);
-		if (i == -1)
-			break;
+	uint64_t const base = first ? s->tasks[first - 1U].end : 0U;
+	s->n_tasks = end - first;
+	(void)memmove(s->tasks, &s->tasks[first],
+	              s->n_tasks * sizeof *s->tasks);
+	for (uint32_t i = 0U; i < s->n_tasks; ++i) {
+		s->tasks[i].head.task = &s->tasks[i];
+		s->tasks[i].end -= base;
 	}
+}
 
-#ifndef _WIN32
-	return (void *)(uintptr_t)count;
-#else
-	_endthreadex(count);
-# ifdef _MSC_VER
-	return count;
-# endif // _MSC_VER
-#endif // _WIN32
+// Most tasks that --split-depth may give, as a multiple of the number
+// of tasks wanted to keep the workers busy
+#define SPLIT_TASKS_MAX 4U
+
+/**
+ * @brief Round a node length up to one that the order 6 engines can
+ *        start a search from.
+ */
+static const_inline uint32_t
+split_align (uint32_t const len)
+{
+	return len <= 16U ? 16U
+	                  : len + (SUB_LEN - (len - 16U) % SUB_LEN) % SUB_LEN;
 }
 
-static uint32_t
-solver_start_workers (struct solver *s)
+/**
+ * @brief Count candidates @a seq to @a end of level @a sp, and the
+ *        levels under them down to @a to, like the engines would.
+ */
+static void
+plan_scan (struct scan_stats *const st,
+           uint64_t                 seq,
+           uint64_t const           end,
+           uint64_t const           map,
+           uint32_t const           sp,
+           uint32_t const           to,
+           bool const               sym)
 {
-	uint32_t i = 0U;
+	uint64_t ext = scan_ext(seq, end, map);
+	uint64_t const n = count_ones(ext);
+	st->valid += n;
+	st->invalid += end - seq + 1U - n;
 
-	for (uint32_t n = s->n_workers; i < n; ) {
-		int e = worker_start(&s->workers[i], worker_func);
-		if (!e) {
-			++i;
+	for (seq = seq >> SUB_LEN << SUB_LEN; ext; ext &= ext - 1U) {
+		uint64_t const c = seq | count_lsb_1(~ext);
+		uint64_t const m = map | window_bits(c, SUB_LEN);
+		if (sym && sp >= SYM_LEVEL && !(m & UINT64_C(1) << SUB_MASK))
 			continue;
+		st->nodes[sp]++;
+		if (sp + 1U < to) {
+			uint64_t const d = c << SUB_LEN;
+			plan_scan(st, d + count_lsb_1(m),
+			          d + SUB_LAST - count_msb_1(m), m, sp + 1U, to,
+			          sym);
 		}
-		--n;
-		(void)fprintf(stderr, "worker_start: %s\n", strerror(e));
 	}
-
-	return i;
 }
 
-static uintptr_t
-solver_wait_workers (struct solver *s,
-                     uint32_t       n)
+/**
+ * @brief Count the statistics of the levels that planning went down
+ *        through, from @a from to @a to bits.
+ *
+ * The engines only count the levels below the tasks, and how deep the
+ * tasks are depends on the number of workers. The levels above them,
+ * down from the shallowest tasks there could have been, are counted
+ * here so that the totals of --stats don't.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+plan_stats (struct scan_stats *const st,
+            struct node const *const root,
+            uint32_t const           from,
+            uint32_t const           to,
+            bool const               sym)
 {
-	uintptr_t seq_count = 0U;
+	if (from >= to)
+		return 0;
 
-	for (uint32_t i = 0U; i < n; ++i) {
-		seq_count += worker_wait(&s->workers[i]);
+	struct node_vec v = {0};
+	int e = node_expand(&v, root, SUB_LEN, from);
+	for (size_t i = 0U; !e && i < v.len; ++i) {
+		struct node const *const x = &v.ptr[i];
+		if (task_seq_find((uint16_t)(x->seq[0] >> 48U)) < 0)
+			continue;
+		uint64_t const seq = x->seq[0] >> (64U - x->len) << SUB_LEN;
+		uint64_t const map = x->map[0];
+		plan_scan(st, seq + count_lsb_1(map),
+		          seq + SUB_LAST - count_msb_1(map), map,
+		          (x->len - 16U) / SUB_LEN, (to - 16U) / SUB_LEN, sym);
+	}
+
+	free(v.ptr);
+	return e;
+}
+
+/**
+ * @brief Divide the search into tasks.
+ *
+ * Each task is a node of the search tree, and the tasks are all nodes at
+ * the split depth that descend from the prefix. For order 6 the depth is
+ * aligned to the levels of the order 6 search engines, which start from
+ * 16-bit nodes and add 6 bits at a time. The sizes of 16-bit tasks are
+ * known exactly from the task tables, and those of deeper tasks are
+ * bounded by the sizes of their 16-bit ancestors. Orders other than 6,
+ * and order 6 depths too deep for those engines, are split a bit at
+ * a time, and their sizes aren't known.
+ *
+ * The automatic depth for order 6 is that of the task tables, unless a
+ * long prefix leaves too few tasks for the workers. In that case, and
+ * for other orders, the tree is split further until there's enough.
+ * A chosen depth is only gone down to as long as that gives at most
+ * @ref SPLIT_TASKS_MAX times as many tasks. More would only add to the
+ * overhead of handing them out and writing them, and the sizes of the
+ * deeper tasks are only loose upper bounds.
+ */
+static int
+solver_plan (struct solver           *s,
+             struct solver_cfg const *cfg)
+{
+	uint32_t const n = cfg->order;
+	struct node root;
+	int e = node_root(&root, n, cfg->prefix, cfg->prefix_len);
+	if (e) {
+		(void)fprintf(stderr, "No order %" PRIu32 " sequence begins"
+		              " with the given prefix\n", n);
+		return e;
+	}
+
+	uint32_t const seq_len = 1U << n;
+	uint32_t const last = 16U + SUB_LEN * (countof(((struct stk *)0)->stk) - 1U);
+	uint32_t len = root.len;
+	uint32_t depth = len;
+
+	// The search form of a sequence has an extra leading bit
+	if (cfg->split && cfg->split + 1U > depth)
+		depth = cfg->split < seq_len ? cfg->split + 1U : seq_len;
+
+	uint32_t step = 1U;
+	bool aligned = n == SUB_LEN;
+	if (aligned) {
+		uint32_t a = split_align(depth);
+		aligned = a <= last;
+		if (aligned) {
+			depth = a;
+			len = split_align(len);
+			step = SUB_LEN;
+		}
+	}
+	uint32_t const base = len;
+
+	struct node_vec v = {0};
+	e = node_expand(&v, &root, n, len);
+
+	// The shards of a run can be on hosts with different numbers of
+	// CPUs, so then there has to be enough tasks for each shard rather
+	// than for the workers. A checkpoint is only valid for the same
+	// tasks, so a run that is resumed with another thread count has
+	// to plan them the same way.
+	size_t const want = cfg->shards ? SHARD_TASKS * (size_t)cfg->shards
+	                  : cfg->checkpoint ? SHARD_TASKS
+	                  : 8U * (size_t)s->n_workers;
+
+	// Go down to the chosen depth a level at a time, but no further
+	// than a few times as many tasks as are wanted
+	bool capped = false;
+	while (!e && len < depth) {
+		e = node_vec_expand(&v, n, len + step, SPLIT_TASKS_MAX * want);
+		if (e == E2BIG) {
+			e = 0;
+			capped = true;
+			break;
+		}
+		if (!e)
+			len += step;
+	}
+
+	// Refine until there's enough tasks to keep all workers busy,
+	// unless the tasks already are the ones in the task tables.
+	while (!e && !cfg->split && (n != SUB_LEN || len > 16U) &&
+	       v.len < want &&
+	       len + step <= (aligned ? last : seq_len)) {
+		len += step;
+		e = node_vec_expand(&v, n, len, SIZE_MAX);
+	}
+
+	if (!e && v.len > (size_t)INT32_MAX)
+		e = E2BIG;
+	if (!e) {
+		s->tasks = calloc(v.len ? v.len : 1U, sizeof *s->tasks);
+		if (!s->tasks)
+			e = ENOMEM;
+	}
+
+	if (e) {
+		free(v.ptr);
+		return e;
+	}
+
+	uint64_t end = 0U;
+	uint32_t k = 0U;
+	for (size_t i = 0U; i < v.len; ++i) {
+		struct task *t = &s->tasks[k];
+		t->node = v.ptr[i];
+		if (n == SUB_LEN) {
+			int32_t j = task_seq_find((uint16_t)(t->node.seq[0] >> 48U));
+			if (j < 0)
+				continue;
+			t->size = task_seq_count[j];
+			t->exact = t->node.len == 16U;
+		}
+		end += t->size * s->words * sizeof(uint64_t);
+		t->end = end;
+		t->head.task = t;
+		if (aligned) {
+			// The children of the node, as in scan()
+			uint64_t seq = t->node.seq[0] >> (64U - t->node.len);
+			uint64_t map = t->node.map[0];
+			seq <<= SUB_LEN;
+			t->head.seq = seq + count_lsb_1(map);
+			t->head.end = seq + SUB_LAST - count_msb_1(map);
+			t->head.map = map;
+			t->head.sp = (t->node.len - 16U) / SUB_LEN;
+		}
+		++k;
+	}
+
+	free(v.ptr);
+	s->n_tasks = k;
+
+	// Shards are planned the same for any number of workers
+	if (cfg->stats && aligned && !cfg->shards) {
+		e = plan_stats(&s->above, &root, base, len, cfg->sym);
+		if (e) {
+			free(s->tasks);
+			return e;
+		}
+	}
+
+	if (cfg->verbose && capped)
+		(void)fprintf(stderr, "Going deeper than %" PRIu32 " bits would"
+		              " give too many tasks\n", len - 1U);
+	if (cfg->verbose)
+		(void)fprintf(stderr, "Split into %" PRIu32 " tasks of %"
+		              PRIu32 " bits\n", k, len - 1U);
+	if (cfg->shards) {
+		solver_shard(s, cfg->shard, cfg->shards);
+		if (cfg->verbose && s->n_tasks)
+			(void)fprintf(stderr, "Shard %" PRIu32 " of %" PRIu32
+			              " has tasks %" PRIu32 " to %" PRIu32 "\n",
+			              cfg->shard, cfg->shards, s->shard.first,
+			              s->shard.end - 1U);
+		else if (cfg->verbose)
+			(void)fprintf(stderr, "Shard %" PRIu32 " of %" PRIu32
+			              " has no tasks\n", cfg->shard, cfg->shards);
+	}
+	s->scan = aligned && cfg->engine != ENGINE_GENERIC
+	          ? engines[cfg->engine][cfg->sink][cfg->stats] : nullptr;
+	s->count = s->scan ? engines[cfg->engine][SINK_COUNT][false]
+	                   : nullptr;
+	return 0;
+}
+
+/**
+ * @brief Allocate a solver.
+ *
+ * The @a mem_limit member of @a cfg is the maximum number of bytes of
+ * finished output to hold in memory at any one time, or 0 for no limit.
+ * The task that is next in line to be written is always allowed to run,
+ * so the effective minimum is the size of the largest task.
+ *
+ * @param cfg Configuration.
+ * @param err Where to store an error code on failure. Optional.
+ * @return    A solver object, or a null pointer on failure.
+ */
+static struct solver *
+solver_create (struct solver_cfg const *cfg,
+               int                     *err)
+{
+	enum leaf_kernel const k = kernel_leaf[cfg->kernel];
+	if (!leaf_supported(k)) {
+		(void)fprintf(stderr, "The CPU doesn't support this kernel\n");
+		if (err)
+			*err = ENOTSUP;
+		return nullptr;
+	}
+	leaf_func_t *const leaf = leaf_get(k);
+
+	// The complement of a sequence can begin with any prefix
+	if (cfg->sym && (cfg->order != SUB_LEN || cfg->prefix_len ||
+	                 cfg->engine == ENGINE_GENERIC)) {
+		(void)fprintf(stderr, "Symmetry reduction needs a full"
+		              " order 6 search with an order-6 engine\n");
+		if (err)
+			*err = EINVAL;
+		return nullptr;
+	}
+
+	if (cfg->format == FORMAT_PACKED && cfg->order != SUB_LEN) {
+		(void)fprintf(stderr, "The packed format only supports"
+		              " order 6\n");
+		if (err)
+			*err = EINVAL;
+		return nullptr;
+	}
+
+	uint32_t n_workers = cfg->threads;
+	if (!n_workers)
+		n_workers = nproc();
+
+	if (cfg->verbose)
+		(void)fprintf(stderr, "Using %" PRIu32 " threads\n", n_workers);
+
+	struct solver *s = calloc(1U, offsetof(struct solver,
+	                                       workers[n_workers]));
+	if (!s) {
+		if (err)
+			*err = errno ? errno : ENOMEM;
+		return nullptr;
+	}
+
+	s->n_workers = n_workers;
+	s->order = cfg->order;
+	s->words = order_words(cfg->order);
+
+	int e = solver_plan(s, cfg);
+	if (!e) {
+		e = lock_init(&s->lock);
+		if (e)
+			free(s->tasks);
+	}
+	if (e) {
+		free(s);
+		if (err)
+			*err = e;
+		return nullptr;
+	}
+
+	s->mem_limit = cfg->mem_limit ? cfg->mem_limit : UINT64_MAX;
+	s->sym = cfg->sym;
+	s->sink = cfg->sink;
+	s->stats = cfg->stats;
+	s->perf = cfg->perf;
+	s->progress = cfg->progress;
+	s->digest = (cfg->digest || cfg->checkpoint) && cfg->sink == SINK_STORE;
+	s->ckpt.dir = cfg->checkpoint;
+	s->ckpt.resume = cfg->resume;
+	s->status_fd = cfg->status_fd;
+	s->pack = cfg->format == FORMAT_PACKED;
+	atomic_init(&s->hungry, 0U);
+	atomic_init(&s->finished, 0U);
+
+	for (uint32_t i = 0U; i < n_workers; ++i) {
+		struct stk *stk = &s->workers[i].stk;
+		s->workers[i].id = i;
+		stk->hungry = &s->hungry;
+		stk->leaf = leaf;
+		stk->onehot = cfg->kernel != KERNEL_LOOP;
+		for (uint32_t j = SYM_LEVEL; s->sym && j < countof(stk->need); ++j)
+			stk->need[j] = UINT64_C(1) << SUB_MASK;
+		atomic_init(&s->workers[i].queued, 0U);
+		atomic_init(&s->workers[i].found, 0U);
+	}
+
+	if (cfg->trace) {
+		e = trace_init(&s->trace);
+		for (uint32_t i = 0U; !e && i < n_workers; ++i)
+			e = trace_init(&s->workers[i].trace);
+		if (e) {
+			for (uint32_t i = 0U; i < n_workers; ++i)
+				trace_free(&s->workers[i].trace);
+			trace_free(&s->trace);
+			lock_fini(&s->lock);
+			free(s->tasks);
+			free(s);
+			if (err)
+				*err = e;
+			return nullptr;
+		}
+	}
+
+	return s;
+}
+
+static void
+solver_free_tasks (struct solver *s)
+{
+	for (size_t i = 0U; i < s->n_tasks; ++i) {
+		if (!s->map)
+			free(s->tasks[i].head.out.begin[0]);
+		free(s->tasks[i].sym.begin[0]);
+		s->tasks[i].head.out = u64_view(nullptr, nullptr);
+		s->tasks[i].sym = u64_view(nullptr, nullptr);
+		pack_free(&s->tasks[i].pack);
+	}
+}
+
+static void
+solver_destroy (struct solver **pp)
+{
+	if (pp) {
+		struct solver *s = *pp;
+		*pp = nullptr;
+		if (s) {
+			solver_free_tasks(s);
+			free(s->tasks);
+			free(s->memo);
+			free(s->scratch);
+			trace_free(&s->trace);
+			for (uint32_t i = 0U; i < s->n_workers; ++i) {
+				trace_free(&s->workers[i].trace);
+				free(s->workers[i].tmp.ptr);
+			}
+			lock_fini(&s->lock);
+			free(s);
+		}
+	}
+}
+
+/**
+ * @brief Get the position of task @a id in the complete output.
+ *
+ * @return Offset in units of 64-bit words.
+ */
+static force_inline size_t
+solver_offset (struct solver const *s,
+               uint32_t             id)
+{
+	return id ? (size_t)(s->tasks[id - 1U].end / sizeof *s->map) : 0U;
+}
+
+/**
+ * @brief Check whether the size of the output is known in advance.
+ */
+static bool
+solver_exact (struct solver const *s)
+{
+	for (size_t i = 0U; i < s->n_tasks; ++i) {
+		if (!s->tasks[i].exact)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Wait until there is room for the output of task @a id.
+ *
+ * Tasks are handed out in ascending order, and the writer consumes them
+ * in the same order, so the output buffered at any time is a subset of
+ * the tasks from the writer's position up to the most recently reserved
+ * one. Bounding that interval bounds the memory in use. Where only upper
+ * bounds of the sizes are known, they can be far too large, so then the
+ * output that the finished pieces hold is counted instead.
+ */
+static void
+solver_reserve (struct solver *s,
+                uint32_t       id)
+{
+	if (s->mem_limit == UINT64_MAX)
+		return;
+
+	bool const exact = s->tasks[id].exact;
+	lock_acquire(&s->lock);
+	for (uint32_t w; (w = s->write_next) != id; lock_wait(&s->lock)) {
+		uint64_t beg = w ? s->tasks[w - 1U].end : 0U;
+		if (exact ? s->tasks[id].end - beg <= s->mem_limit
+		          : s->held <= s->mem_limit)
+			break;
+	}
+	lock_release(&s->lock);
+}
+
+/**
+ * @brief Hand a finished piece over to the writer.
+ */
+static void
+solver_complete (struct solver   *s,
+                 struct piece    *p,
+                 struct u64_view  v,
+                 uint64_t         n,
+                 int              e)
+{
+	lock_acquire(&s->lock);
+	p->out = v;
+	p->count = n;
+	p->error = e;
+	p->done = true;
+	s->active--;
+	s->held += u64_view_len(v) * sizeof *v.begin[0];
+	lock_wake(&s->lock);
+	lock_release(&s->lock);
+}
+
+/**
+ * @brief Take the output of piece @a p once it's finished.
+ *
+ * @param s    Solver.
+ * @param p    Piece.
+ * @param v    Where to store the output.
+ * @param n    Where to store the number of sequences.
+ * @param next Where to store the next piece of the same task, which
+ *             can't change after @a p is finished.
+ * @return     0 on success, or the error the piece failed with.
+ */
+static int
+solver_collect (struct solver   *s,
+                struct piece    *p,
+                struct u64_view *v,
+                uint64_t        *n,
+                struct piece   **next)
+{
+	lock_acquire(&s->lock);
+	while (!p->done)
+		lock_wait(&s->lock);
+	*v = p->out;
+	*n = p->count;
+	*next = p->next;
+	s->held -= u64_view_len(p->out) * sizeof *v->begin[0];
+	p->out = u64_view(nullptr, nullptr);
+	int e = p->error;
+	lock_release(&s->lock);
+	return e;
+}
+
+/**
+ * @brief Mark task @a id as written and let blocked workers re-check
+ *        their reservations.
+ */
+static void
+solver_release (struct solver *s,
+                uint32_t       id)
+{
+	lock_acquire(&s->lock);
+	s->write_next = id + 1U;
+	lock_wake(&s->lock);
+	lock_release(&s->lock);
+	atomic_store_explicit(&s->finished, id + 1U, memory_order_relaxed);
+}
+
+/*
+ * The deques are only touched when a piece is split off or stolen, and
+ * that only happens while some worker is idle, so they share the solver
+ * lock instead of each having one of their own. The owner of a deque
+ * takes its newest piece, thieves take the oldest and largest one.
+ */
+
+static void
+deque_push (struct worker *w,
+            struct piece  *p)
+{
+	uint32_t n = atomic_load_explicit(&w->queued, memory_order_relaxed);
+	w->deque[(w->head + n) % DEQUE_LEN] = p;
+	atomic_store_explicit(&w->queued, n + 1U, memory_order_relaxed);
+}
+
+static struct piece *
+deque_pop (struct worker *w)
+{
+	uint32_t n = atomic_load_explicit(&w->queued, memory_order_relaxed);
+	if (!n--)
+		return nullptr;
+	atomic_store_explicit(&w->queued, n, memory_order_relaxed);
+	return w->deque[(w->head + n) % DEQUE_LEN];
+}
+
+static struct piece *
+deque_steal (struct worker *w)
+{
+	uint32_t n = atomic_load_explicit(&w->queued, memory_order_relaxed);
+	if (!n--)
+		return nullptr;
+	struct piece *p = w->deque[w->head];
+	w->head = (w->head + 1U) % DEQUE_LEN;
+	atomic_store_explicit(&w->queued, n, memory_order_relaxed);
+	return p;
+}
+
+/**
+ * @brief Split off part of the current piece of a worker.
+ *
+ * Called by the worker itself from its search loop when some other
+ * worker is idle. Takes the upper half of the untried candidates of the
+ * shallowest level that has any left and queues them as a new piece.
+ *
+ * @param stk Search state of the worker.
+ * @param sp  One past the deepest level with an up-to-date frame.
+ */
+static void
+stk_split (struct stk *stk,
+           uint32_t    sp)
+{
+	struct worker *w = container_of(stk, struct worker, stk);
+	struct solver *s = container_of(w, struct solver, workers[w->id]);
+
+	uint32_t n = atomic_load_explicit(&w->queued, memory_order_relaxed);
+	if (n >= DEQUE_LEN ||
+	    n >= atomic_load_explicit(&s->hungry, memory_order_relaxed))
+		return;
+
+	uint32_t l = stk->top;
+	while (l < sp && !stk->ext[l])
+		++l;
+	if (l == sp)
+		return;
+
+	struct piece *p = calloc(1U, sizeof *p);
+	if (!p)
+		return;
+
+	// Keep the lower half of the candidates that are left
+	uint64_t ext = stk->ext[l];
+	uint64_t low = 0U;
+	for (uint32_t k = count_ones(ext) / 2U; k; --k) {
+		low |= ext & (UINT64_C(0) - ext);
+		ext &= ext - 1U;
+	}
+
+	uint64_t const seq = stk->seq[l] >> SUB_LEN << SUB_LEN;
+	p->task = w->piece->task;
+	p->seq = seq | count_lsb_1(~ext);
+	p->end = seq | (SUB_LAST - count_msb_1(~ext));
+	p->map = stk->stk[l].map;
+	p->sp = l;
+	stk->ext[l] = low;
+
+	lock_acquire(&s->lock);
+	p->next = w->piece->next;
+	w->piece->next = p;
+	deque_push(w, p);
+	s->active++;
+	lock_wake(&s->lock);
+	lock_release(&s->lock);
+}
+
+/**
+ * @brief Get the next piece for worker @a w to search.
+ *
+ * Prefers the worker's own queued pieces, then new tasks, and finally
+ * steals from other workers. Waits if there's nothing to do yet.
+ *
+ * @return A piece, or a null pointer once everything is done.
+ */
+static struct piece *
+solver_next (struct solver *s,
+             struct worker *w)
+{
+	struct piece *p = nullptr;
+	uint32_t id = UINT32_MAX;
+
+	lock_acquire(&s->lock);
+	for (;;) {
+		p = deque_pop(w);
+		if (p)
+			break;
+
+		// Hand out tasks in ascending order so that the writer,
+		// which consumes them in that order, can keep up.
+		if (s->task_next < s->n_tasks) {
+			id = s->task_next++;
+			p = &s->tasks[id].head;
+			s->active++;
+			break;
+		}
+
+		for (uint32_t i = 1U; !p && i < s->n_workers; ++i)
+			p = deque_steal(&s->workers[(w->id + i) % s->n_workers]);
+		if (p || !s->active)
+			break;
+
+		atomic_fetch_add_explicit(&s->hungry, 1U, memory_order_relaxed);
+		lock_wait(&s->lock);
+		atomic_fetch_sub_explicit(&s->hungry, 1U, memory_order_relaxed);
+	}
+	lock_release(&s->lock);
+
+	if (id != UINT32_MAX)
+		solver_reserve(s, id);
+
+	return p;
+}
+
+/**
+ * @brief Add the statistics of a finished piece to its worker and task.
+ *
+ * @param s      Solver.
+ * @param w      Worker.
+ * @param before The search counters of @a w before the piece.
+ * @param perf   Hardware events counted on the piece.
+ * @param id     Task of the piece.
+ * @param n      Number of sequences found.
+ * @param ms     Time spent on the piece.
+ */
+static void
+stats_piece (struct solver *const           s,
+             struct worker *const           w,
+             struct scan_stats const *const before,
+             struct perf_count const *const perf,
+             uint32_t const                 id,
+             uint64_t const                 n,
+             double const                   ms)
+{
+	struct scan_stats const *const after = &w->stk.stats;
+	w->busy += ms;
+	w->pieces++;
+	w->count += n;
+	for (size_t i = 0U; i < countof(perf->v); ++i)
+		w->counts.v[i] += perf->v[i];
+
+	// Pieces of the same task can finish on several workers at once
+	lock_acquire(&s->lock);
+	struct task *const t = &s->tasks[id];
+	t->ms += ms;
+	t->pieces++;
+	t->count += n;
+	for (size_t i = 0U; i < countof(t->stats.nodes); ++i)
+		t->stats.nodes[i] += after->nodes[i] - before->nodes[i];
+	t->stats.valid += after->valid - before->valid;
+	t->stats.invalid += after->invalid - before->invalid;
+	t->stats.found += after->found - before->found;
+	for (size_t i = 0U; i < countof(perf->v); ++i)
+		t->perf.v[i] += perf->v[i];
+	lock_release(&s->lock);
+}
+
+#ifndef _WIN32
+static void *
+#else
+static unsigned __stdcall
+#endif
+worker_func (void *arg)
+{
+	struct worker *w = arg;
+	struct solver *s = container_of(w, struct solver, workers[w->id]);
+	unsigned count = 0U;
+	bool const timed = s->stats || s->perf || w->trace.ev;
+	double const start = trace_clock(&w->trace);
+	if (s->perf)
+		(void)perf_open(&w->perf);
+
+	for (;;) {
+		double const t0 = timed ? clock_ms() : 0.0;
+		struct piece *p = solver_next(s, w);
+		double const t1 = timed ? clock_ms() : 0.0;
+		w->idle += t1 - t0;
+		trace_add(&w->trace, (struct trace_event){
+			.begin = t0,
+			.end   = t1,
+			.id    = UINT32_MAX,
+			.kind  = TRACE_IDLE,
+		});
+		if (!p)
+			break;
+
+		struct task const *t = p->task;
+		uint32_t const id = (uint32_t)(t - s->tasks);
+		struct u64_view v = u64_view(nullptr, nullptr);
+		struct scan_stats const before = w->stk.stats;
+		uint64_t n = 0U;
+		struct perf_count c0 = {0}, c1 = {0}, pc = {0};
+		w->piece = p;
+		if (s->perf)
+			perf_read(&w->perf, &c0);
+		int e = piece_solve(s, &w->stk, &w->trace, &w->tmp, p,
+		                    s->map && p == &t->head
+		                    ? &s->map[solver_offset(s, id)]
+		                    : nullptr, &v, &n);
+		if (s->perf) {
+			perf_read(&w->perf, &c1);
+			perf_add(&pc, &c0, &c1);
+		}
+		// Hash while the output is still in the cache, unless the
+		// task has yet to be completed with solver_finish()
+		if (s->digest && !s->sym && !s->pack && !e)
+			p->digest = digest_words(v.begin[0], u64_view_len(v));
+		double const t2 = timed ? clock_ms() : 0.0;
+		uint32_t bits = 0U;
+		trace_add(&w->trace, (struct trace_event){
+			.begin = t1,
+			.end   = t2,
+			.arg   = w->trace.ev ? task_prefix(t, &bits) : 0U,
+			.id    = id,
+			.kind  = TRACE_PIECE,
+			.bits  = (uint8_t)bits,
+			.split = p != &t->head,
+		});
+		count += (unsigned)n;
+		atomic_fetch_add_explicit(&w->found, n, memory_order_relaxed);
+		if (s->stats || s->perf)
+			stats_piece(s, w, &before, &pc, id, n, t2 - t1);
+		solver_complete(s, p, v, n, e);
+	}
+
+	perf_close(&w->perf);
+	trace_add(&w->trace, (struct trace_event){
+		.begin = start,
+		.end   = trace_clock(&w->trace),
+		.id    = UINT32_MAX,
+		.kind  = TRACE_THREAD,
+	});
+
+#ifndef _WIN32
+	return (void *)(uintptr_t)count;
+#else
+	_endthreadex(count);
+# ifdef _MSC_VER
+	return count;
+# endif // _MSC_VER
+#endif // _WIN32
+}
+
+/**
+ * @brief Find the task that a sequence belongs to.
+ *
+ * @return Index of the task, or `UINT32_MAX` if there is none.
+ */
+static uint32_t
+solver_find (struct solver const *s,
+             uint64_t             seq)
+{
+	// Tasks are searched in the same form as the nodes
+	seq = rol_64(seq, SUB_LAST);
+
+	uint32_t lo = 0U, hi = s->n_tasks;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2U;
+		struct node const *n = &s->tasks[mid].node;
+		if ((n->seq[0] & ~(UINT64_MAX >> n->len)) <= seq)
+			lo = mid + 1U;
+		else
+			hi = mid;
+	}
+
+	struct node const *n = lo ? &s->tasks[lo - 1U].node : nullptr;
+	return n && !((n->seq[0] ^ seq) & ~(UINT64_MAX >> n->len))
+	       ? lo - 1U : UINT32_MAX;
+}
+
+/**
+ * @brief Collect the complements of the sequences found with
+ *        --symmetry into the tasks they belong to.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+solver_derive (struct solver *s)
+{
+	size_t *n = calloc(s->n_tasks, sizeof *n);
+	if (!n)
+		return ENOMEM;
+
+	// Count first, then fill in
+	int e = 0;
+	for (uint32_t pass = 0U; !e && pass < 2U; ++pass) {
+		for (uint32_t i = 0U; !e && i < s->n_tasks; ++i) {
+			struct u64_view v = s->tasks[i].head.out;
+			for (uint64_t const *p = v.begin[0]; p != v.end[0]; ++p) {
+				uint32_t o = sym_ones(*p);
+				if (o >= SEQ_LEN - SYM_ONES_MAX)
+					continue;
+				uint64_t c = sym_complement(*p, o);
+				uint32_t j = solver_find(s, c);
+				if (j == UINT32_MAX) {
+					e = EPROTO;
+					break;
+				}
+				if (pass)
+					*s->tasks[j].sym.end[0]++ = c;
+				else
+					n[j]++;
+			}
+		}
+
+		for (uint32_t i = 0U; !e && !pass && i < s->n_tasks; ++i) {
+			uint64_t *q = malloc((n[i] ? n[i] : 1U) * sizeof *q);
+			if (!q)
+				e = ENOMEM;
+			else
+				s->tasks[i].sym = u64_view(q, q);
+		}
+	}
+
+	free(n);
+	return e;
+}
+
+/**
+ * @brief Sort the derived sequences of task @a t and merge them into
+ *        the searched ones.
+ */
+static int
+task_merge (struct solver const *s,
+            struct task         *t)
+{
+	size_t const cap = (size_t)t->size * s->words;
+	size_t const n = u64_view_len(t->head.out);
+	size_t const m = u64_view_len(t->sym);
+	if (n + m > cap)
+		return EPROTO;
+
+	uint64_t *tmp = malloc((m ? m : 1U) * sizeof *tmp);
+	if (!tmp)
+		return ENOMEM;
+	u64_sort(t->sym.begin[0], tmp, m);
+	free(tmp);
+
+	u64_merge(t->head.out.begin[0], n, t->sym.begin[0], m);
+	t->head.out.end[0] += m;
+	free(t->sym.begin[0]);
+	t->sym = u64_view(nullptr, nullptr);
+	return 0;
+}
+
+/**
+ * @brief Encode the output of task @a t with --format packed.
+ */
+static int
+task_pack (struct task *t,
+           leaf_func_t *leaf)
+{
+	uint64_t *const v = t->head.out.begin[0];
+	int e = pack_encode(&t->pack, v, u64_view_len(t->head.out), leaf);
+	free(v);
+	t->head.out = u64_view(nullptr, nullptr);
+	return e;
+}
+
+#ifndef _WIN32
+static void *
+#else
+static unsigned __stdcall
+#endif
+finish_func (void *arg)
+{
+	struct worker *w = arg;
+	struct solver *s = container_of(w, struct solver, workers[w->id]);
+	unsigned count = 0U;
+	double const start = trace_clock(&w->trace);
+
+	for (;;) {
+		lock_acquire(&s->lock);
+		uint32_t id = s->task_next < s->n_tasks
+		              ? s->task_next++ : UINT32_MAX;
+		lock_release(&s->lock);
+		if (id == UINT32_MAX)
+			break;
+
+		struct task *t = &s->tasks[id];
+		double const t0 = trace_clock(&w->trace);
+		int e = 0;
+		if (s->sym) {
+			count += (unsigned)u64_view_len(t->sym);
+			e = task_merge(s, t);
+		}
+		if (s->digest && !e)
+			t->digest = digest_words(t->head.out.begin[0],
+			                         u64_view_len(t->head.out));
+		if (s->pack && !e)
+			e = task_pack(t, w->stk.leaf);
+		uint32_t bits = 0U;
+		trace_add(&w->trace, (struct trace_event){
+			.begin = t0,
+			.end   = trace_clock(&w->trace),
+			.arg   = w->trace.ev ? task_prefix(t, &bits) : 0U,
+			.id    = id,
+			.kind  = TRACE_FINISH,
+			.bits  = (uint8_t)bits,
+		});
+
+		lock_acquire(&s->lock);
+		t->head.error = e;
+		t->head.done = true;
+		lock_wake(&s->lock);
+		lock_release(&s->lock);
+	}
+
+	trace_add(&w->trace, (struct trace_event){
+		.begin = start,
+		.end   = trace_clock(&w->trace),
+		.id    = UINT32_MAX,
+		.kind  = TRACE_THREAD,
+	});
+
+#ifndef _WIN32
+	return (void *)(uintptr_t)count;
+#else
+	_endthreadex(count);
+# ifdef _MSC_VER
+	return count;
+# endif // _MSC_VER
+#endif // _WIN32
+}
+
+static uint32_t
+solver_start_workers (struct solver *s,
+                      worker_func_t *f)
+{
+	uint32_t i = 0U;
+
+	for (uint32_t n = s->n_workers; i < n; ) {
+		int e = worker_start(&s->workers[i], f);
+		if (!e) {
+			++i;
+			continue;
+		}
+		--n;
+		(void)fprintf(stderr, "worker_start: %s\n", strerror(e));
+	}
+
+	return i;
+}
+
+static uintptr_t
+solver_wait_workers (struct solver *s,
+                     uint32_t       n)
+{
+	uintptr_t seq_count = 0U;
+
+	for (uint32_t i = 0U; i < n; ++i) {
+		seq_count += worker_wait(&s->workers[i]);
+	}
+
+	return seq_count;
+}
+
+/**
+ * @brief Pass finished output on to the callback, if there is one, or
+ *        else write it to @a f, if that isn't a null pointer.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+solver_emit (struct solver const *s,
+             FILE                *f,
+             uint64_t const      *ptr,
+             size_t               len)
+{
+	if (s->batch)
+		return s->batch(s->batch_ctx, ptr, len);
+
+	if (!f || fwrite(ptr, sizeof *ptr, len, f) == len)
+		return 0;
+
+	int e = errno ? errno : EIO;
+	perror("fwrite");
+	return e;
+}
+
+/**
+ * @brief Complete a --symmetry search or --format packed output and
+ *        write out the result.
+ *
+ * The searched sequences of each task have to be in the output view of
+ * its head piece, with room for all of the task's sequences. With
+ * --symmetry the ones that weren't searched for are derived from them
+ * and merged in, and with --format packed the result is encoded. The
+ * workers do both task by task while this thread writes the tasks in
+ * order.
+ *
+ * @param s     Solver.
+ * @param f     Output file, or a null pointer to only benchmark or to
+ *              use the callback.
+ * @param count Where to add the number of derived sequences.
+ * @return      0 on success, otherwise an error code.
+ */
+static int
+solver_finish (struct solver *s,
+               FILE          *f,
+               uintptr_t     *count)
+{
+	int e = s->sym ? solver_derive(s) : 0;
+	if (e) {
+		(void)fprintf(stderr, "solver_derive: %s\n", strerror(e));
+		return e;
+	}
+
+	s->task_next = 0U;
+	for (uint32_t i = 0U; i < s->n_tasks; ++i)
+		s->tasks[i].head.done = false;
+
+	double t0 = trace_clock(&s->trace);
+	uint32_t n_workers = solver_start_workers(s, finish_func);
+	trace_add(&s->trace, (struct trace_event){
+		.begin = t0,
+		.end   = trace_clock(&s->trace),
+		.id    = UINT32_MAX,
+		.kind  = TRACE_START,
+	});
+	if (!n_workers)
+		return EAGAIN;
+
+	struct pack idx = {0};
+	if (f && s->pack) {
+		e = pack_write_head(f, &idx);
+		if (e)
+			(void)fprintf(stderr, "pack_write_head: %s\n",
+			              strerror(e));
+	}
+
+	for (uint32_t i = 0U; i < s->n_tasks; ++i) {
+		struct task *t = &s->tasks[i];
+		lock_acquire(&s->lock);
+		while (!t->head.done)
+			lock_wait(&s->lock);
+		int te = t->head.error;
+		lock_release(&s->lock);
+
+		size_t len = s->pack ? (size_t)t->pack.count
+		                     : u64_view_len(t->head.out);
+		t0 = trace_clock(&s->trace);
+		if (!te && t->exact && len != (size_t)t->size * s->words)
+			te = EPROTO;
+		if (te) {
+			if (!e) {
+				e = te;
+				(void)fprintf(stderr, "%s: %s\n", s->pack
+				              ? "task_pack" : "task_merge",
+				              strerror(e));
+			}
+		} else if (f && !e && s->pack) {
+			e = pack_write(f, &idx, &t->pack);
+			if (e)
+				(void)fprintf(stderr, "pack_write: %s\n",
+				              strerror(e));
+		} else if ((f || s->batch) && !e && len) {
+			e = solver_emit(s, f, t->head.out.begin[0], len);
+		}
+		if (!te && (f || s->batch)) {
+			trace_add(&s->trace, (struct trace_event){
+				.begin = t0,
+				.end   = trace_clock(&s->trace),
+				.arg   = s->pack ? t->pack.size
+				                 : len * sizeof *s->map,
+				.id    = i,
+				.kind  = TRACE_WRITE,
+			});
+		}
+		free(t->head.out.begin[0]);
+		t->head.out = u64_view(nullptr, nullptr);
+		pack_free(&t->pack);
+	}
+
+	if (f && s->pack && !e) {
+		e = pack_write_tail(f, &idx);
+		if (e)
+			(void)fprintf(stderr, "pack_write_tail: %s\n",
+			              strerror(e));
+		else
+			(void)fprintf(stderr, "Packed into %zu bytes\n",
+			              idx.size + idx.len * sizeof *idx.index
+			              + PACK_TAIL_SIZE);
+	}
+	pack_free(&idx);
+
+	t0 = trace_clock(&s->trace);
+	*count += solver_wait_workers(s, n_workers);
+	trace_add(&s->trace, (struct trace_event){
+		.begin = t0,
+		.end   = trace_clock(&s->trace),
+		.id    = UINT32_MAX,
+		.kind  = TRACE_JOIN,
+	});
+	return e;
+}
+
+/**
+ * @brief Get a monotonic timestamp in milliseconds.
+ */
+static double
+clock_ms (void)
+{
+#ifndef _WIN32
+	struct timespec t = {0};
+	(void)clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec * 1000.0 + (double)t.tv_nsec / 1000000.0;
+#else
+	LARGE_INTEGER pf = {0}, t = {0};
+	QueryPerformanceFrequency(&pf);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart * 1000.0 / (double)pf.QuadPart;
+#endif
+}
+
+static FILE *
+output_open (char const *out)
+{
+	FILE *f = nullptr;
+
+	if (out[0] == '-' && !out[1]) {
+		f = stdout;
+#ifdef _WIN32
+		(void)fflush(stdout);
+		(void)_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	} else {
+#ifndef _WIN32
+		f = fopen(out, "wbe");
+		if (!f &&
+		    (errno != EINVAL || !(f = fopen(out, "wb"))))
+#else
+		f = fopen(out, "wb");
+		if (!f)
+#endif
+			perror("fopen");
+		else
+			(void)fprintf(stderr, "Saving to %s\n", out);
+	}
+
+	return f;
+}
+
+/**
+ * @brief Create a file of @a size bytes and map it into memory.
+ *
+ * @return Pointer to the mapping, or a null pointer on failure.
+ */
+static uint64_t *
+output_map (char const *out,
+            size_t      size)
+{
+	void *p = nullptr;
+#ifndef _WIN32
+	int fd = open(out, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (fd < 0) {
+		perror("open");
+		return nullptr;
+	}
+
+	if (ftruncate(fd, (off_t)size)) {
+		perror("ftruncate");
+	} else {
+		p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+		         MAP_SHARED, fd, 0);
+		if (p == MAP_FAILED) {
+			perror("mmap");
+			p = nullptr;
+		}
+	}
+
+	(void)close(fd);
+#else
+	HANDLE h = CreateFileA(out, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+	                       CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (h == INVALID_HANDLE_VALUE) {
+		(void)fprintf(stderr, "CreateFile: error %lu\n", GetLastError());
+		return nullptr;
+	}
+
+	HANDLE m = CreateFileMappingA(h, nullptr, PAGE_READWRITE,
+	                              (DWORD)((uint64_t)size >> 32U),
+	                              (DWORD)size, nullptr);
+	if (!m) {
+		(void)fprintf(stderr, "CreateFileMapping: error %lu\n",
+		              GetLastError());
+	} else {
+		p = MapViewOfFile(m, FILE_MAP_WRITE, 0, 0, size);
+		if (!p)
+			(void)fprintf(stderr, "MapViewOfFile: error %lu\n",
+			              GetLastError());
+		CloseHandle(m);
+	}
+
+	CloseHandle(h);
+#endif
+	if (p)
+		(void)fprintf(stderr, "Saving to %s\n", out);
+	else
+		(void)remove(out);
+
+	return p;
+}
+
+static void
+output_unmap (uint64_t *map,
+              size_t    size)
+{
+#ifndef _WIN32
+	if (munmap(map, size))
+		perror("munmap");
+#else
+	(void)size;
+	if (!UnmapViewOfFile(map))
+		(void)fprintf(stderr, "UnmapViewOfFile: error %lu\n",
+		              GetLastError());
+#endif
+}
+
+/**
+ * @brief Flush a file and wait until it's on disk.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+file_sync (FILE *f)
+{
+	if (fflush(f))
+		return errno ? errno : EIO;
+#ifndef _WIN32
+	if (fsync(fileno(f)))
+#else
+	if (_commit(_fileno(f)))
+#endif
+		return errno ? errno : EIO;
+	return 0;
+}
+
+/**
+ * @brief Cut a file at @a size bytes and move to its end.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+file_cut (FILE    *f,
+          uint64_t size)
+{
+#ifndef _WIN32
+	if (ftruncate(fileno(f), (off_t)size) ||
+	    fseeko(f, (off_t)size, SEEK_SET))
+#else
+	if (_chsize_s(_fileno(f), (__int64)size) ||
+	    _fseeki64(f, (__int64)size, SEEK_SET))
+#endif
+		return errno ? errno : EIO;
+	return 0;
+}
+
+/**
+ * @brief Get the size of a file in bytes.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+file_size (FILE     *f,
+           uint64_t *size)
+{
+#ifndef _WIN32
+	struct stat st;
+	if (fstat(fileno(f), &st))
+		return errno ? errno : EIO;
+	*size = (uint64_t)st.st_size;
+#else
+	__int64 const n = _filelengthi64(_fileno(f));
+	if (n < 0)
+		return errno ? errno : EIO;
+	*size = (uint64_t)n;
+#endif
+	return 0;
+}
+
+/**
+ * @brief Describe the tasks of a run, to tell whether a checkpoint
+ *        belongs to it.
+ */
+static void
+checkpoint_name (struct solver const *s,
+                 char                *buf,
+                 size_t               size)
+{
+	uint32_t b0 = 0U, b1 = 0U;
+	uint64_t const v0 = s->n_tasks ? task_prefix(&s->tasks[0], &b0) : 0U;
+	uint64_t const v1 = s->n_tasks
+	                    ? task_prefix(&s->tasks[s->n_tasks - 1U], &b1)
+	                    : 0U;
+	(void)snprintf(buf, size, "order %" PRIu32 ", %" PRIu32 " tasks from"
+	               " %" PRIx64 "/%" PRIu32 " to %" PRIx64 "/%" PRIu32,
+	               s->order, s->n_tasks, v0, b0, v1, b1);
+}
+
+/**
+ * @brief Read the journal of a checkpoint to find where to go on from.
+ *
+ * The saved tasks get their digests back, and the journal is cut after
+ * the last complete line.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+checkpoint_load (struct solver *s,
+                 FILE          *j)
+{
+	char name[160], buf[192];
+	checkpoint_name(s, name, sizeof name);
+	if (!fgets(buf, sizeof buf, j) || strncmp(buf, "# dbs26 checkpoint: ",
+	                                          20U) ||
+	    strncmp(&buf[20], name, strlen(name)) ||
+	    buf[20U + strlen(name)] != '\n') {
+		(void)fprintf(stderr, "%s: the checkpoint isn't of this run\n",
+		              s->ckpt.dir);
+		return EINVAL;
+	}
+
+	long end = ftell(j);
+	while (end >= 0 && s->ckpt.next < s->n_tasks &&
+	       fgets(buf, sizeof buf, j)) {
+		uint32_t id = 0U;
+		uint64_t off = 0U, h = 0U;
+		size_t const n = strlen(buf);
+		if (!n || buf[n - 1U] != '\n' ||
+		    sscanf(buf, "%" SCNu32 " %" SCNu64 " %" SCNx64,
+		           &id, &off, &h) != 3 ||
+		    id != s->ckpt.next || off < s->ckpt.offset ||
+		    (off - s->ckpt.offset) % (sizeof *s->map * s->words))
+			break;
+		s->tasks[id].digest = (struct digest){
+			.hash = h,
+			.len  = (off - s->ckpt.offset) / sizeof *s->map,
+		};
+		s->ckpt.next = id + 1U;
+		s->ckpt.offset = off;
+		end = ftell(j);
+	}
+
+	return end < 0 ? errno ? errno : EIO : file_cut(j, (uint64_t)end);
+}
+
+// Words of the output read at a time by checkpoint_check()
+#define CHECKPOINT_CHUNK ((size_t)1U << 16U)
+
+/**
+ * @brief Check that the output file still holds the tasks that the
+ *        journal says were saved in it.
+ *
+ * Every saved task is hashed again and compared to its digest in the
+ * journal, and the header of a shard to that of this one.
+ *
+ * @param s   Solver, with the checkpoint loaded.
+ * @param f   Output file.
+ * @param out Output file name.
+ * @return    0 on success, EBADMSG if the output doesn't match the
+ *            journal, otherwise an error code.
+ */
+static int
+checkpoint_check (struct solver const *s,
+                  FILE                *f,
+                  char const          *out)
+{
+	uint64_t const head = s->shard.count ? SHARD_HEAD_SIZE : 0U;
+	uint64_t size = 0U;
+	int e = file_size(f, &size);
+	if (e)
+		return e;
+	if (size < head + s->ckpt.offset) {
+		(void)fprintf(stderr, "%s is shorter than the %" PRIu64 " bytes"
+		              " saved in the checkpoint\n", out,
+		              head + s->ckpt.offset);
+		return EBADMSG;
+	}
+
+	rewind(f);
+	struct shard h = {0};
+	if (head && (shard_read_head(f, &h) || h.run != s->shard.run ||
+	             h.index != s->shard.index || h.count != s->shard.count)) {
+		(void)fprintf(stderr, "%s isn't this shard\n", out);
+		return EBADMSG;
+	}
+
+	uint64_t *buf = malloc(CHECKPOINT_CHUNK * sizeof *buf);
+	if (!buf)
+		return errno ? errno : ENOMEM;
+
+	for (uint32_t id = 0U; !e && id < s->ckpt.next; ++id) {
+		struct digest d = {0};
+		for (uint64_t left = s->tasks[id].digest.len; !e && left; ) {
+			size_t const n = left < CHECKPOINT_CHUNK
+			                 ? (size_t)left : CHECKPOINT_CHUNK;
+			if (fread(buf, sizeof *buf, n, f) != n)
+				e = ferror(f) ? errno ? errno : EIO : EBADMSG;
+			else
+				d = digest_cat(d, digest_words(buf, n));
+			left -= n;
+		}
+		if (!e && d.hash != s->tasks[id].digest.hash)
+			e = EBADMSG;
+		if (e == EBADMSG)
+			(void)fprintf(stderr, "%s: task %" PRIu32 " doesn't match"
+			              " the checkpoint\n", out, id);
+	}
+
+	free(buf);
+	return e;
+}
+
+/**
+ * @brief Open the output file and the journal of --checkpoint.
+ *
+ * Without --resume, a new journal is started and the output file is
+ * created as usual. With it, the saved part of the output file is
+ * checked with checkpoint_check(), and the file is cut back to where
+ * the journal says the last saved task ended.
+ *
+ * @param s   Solver.
+ * @param out Output file name.
+ * @return    The output file, or a null pointer on failure.
+ */
+static FILE *
+checkpoint_open (struct solver *s,
+                 char const    *out)
+{
+	char const *const dir = s->ckpt.dir;
+#ifndef _WIN32
+	int e = mkdir(dir, 0777) ? errno : 0;
+#else
+	int e = _mkdir(dir) ? errno : 0;
+#endif
+	size_t const len = strlen(dir) + sizeof "/journal";
+	char *path = e && e != EEXIST ? nullptr : malloc(len);
+	FILE *f = nullptr;
+	if (!path) {
+		e = e && e != EEXIST ? e : errno ? errno : ENOMEM;
+		goto fail;
+	}
+	(void)snprintf(path, len, "%s/journal", dir);
+
+	s->ckpt.next = 0U;
+	s->ckpt.offset = 0U;
+	s->ckpt.journal = fopen(path, s->ckpt.resume ? "r+b" : "wb");
+	free(path);
+	if (!s->ckpt.journal) {
+		e = errno ? errno : EIO;
+		goto fail;
+	}
+
+	if (!s->ckpt.resume) {
+		char name[160];
+		checkpoint_name(s, name, sizeof name);
+		(void)fprintf(s->ckpt.journal, "# dbs26 checkpoint: %s\n", name);
+		e = file_sync(s->ckpt.journal);
+		if (!e && !(f = output_open(out)))
+			e = errno ? errno : EIO;
+	} else if (!(e = checkpoint_load(s, s->ckpt.journal))) {
+		f = fopen(out, "r+b");
+		e = !f ? errno ? errno : EIO : checkpoint_check(s, f, out);
+		if (!e)
+			e = file_cut(f, s->ckpt.offset +
+			                (s->shard.count ? SHARD_HEAD_SIZE : 0U));
+		if (!e)
+			(void)fprintf(stderr, "Resuming %s after %" PRIu32 " of"
+			              " %" PRIu32 " tasks\n", out, s->ckpt.next,
+			              s->n_tasks);
+	}
+	if (!e)
+		return f;
+
+	if (f && f != stdout)
+		(void)fclose(f);
+	(void)fclose(s->ckpt.journal);
+	s->ckpt.journal = nullptr;
+fail:
+	(void)fprintf(stderr, "%s: %s\n", dir, strerror(e));
+	errno = e;
+	return nullptr;
+}
+
+/**
+ * @brief Save task @a id, which has just been written out.
+ *
+ * @param s   Solver.
+ * @param f   Output file.
+ * @param id  Task.
+ * @param end Size of the output up to and including the task.
+ * @return    0 on success, otherwise an error code.
+ */
+static int
+checkpoint_task (struct solver *s,
+                 FILE          *f,
+                 uint32_t       id,
+                 uint64_t       end)
+{
+	int e = file_sync(f);
+	if (!e) {
+		(void)fprintf(s->ckpt.journal, "%" PRIu32 " %" PRIu64 " %016"
+		              PRIx64 "\n", id, end, s->tasks[id].digest.hash);
+		e = file_sync(s->ckpt.journal);
+	}
+	if (e)
+		(void)fprintf(stderr, "%s: %s\n", s->ckpt.dir, strerror(e));
+	return e;
+}
+
+/** @brief How often --progress reports, in milliseconds. */
+#define PROGRESS_MS 500U
+
+/**
+ * @brief State of the --progress reporter thread.
+ */
+struct progress {
+	struct solver const *s;
+#ifndef _WIN32
+	pthread_t            tid;
+#else
+	uintptr_t            tid;
+#endif
+	double               start;
+	uint64_t             total; //!< Number of sequences, 0 if not known
+	bool                 tty;   //!< Whether stderr is a terminal
+	_Atomic(bool)        stop;
+};
+
+/**
+ * @brief Print the progress so far to stderr, and to the status file
+ *        descriptor if there is one.
+ *
+ * The counters are read without locking, so the numbers can be a
+ * moment out of date, but never more than what has been done.
+ */
+static void
+progress_report (struct progress const *const p,
+                 bool const                   done)
+{
+	struct solver const *const s = p->s;
+	uint64_t n = 0U;
+	for (uint32_t i = 0U; i < s->n_workers; ++i)
+		n += atomic_load_explicit(&s->workers[i].found,
+		                          memory_order_relaxed);
+	uint32_t const k = atomic_load_explicit(&s->finished,
+	                                        memory_order_relaxed);
+
+	double const ms = clock_ms() - p->start;
+	double const frac = done ? 1.0
+	                  : p->total ? (double)n / (double)p->total
+	                  : s->n_tasks ? (double)k / (double)s->n_tasks
+	                  : 0.0;
+	double const rate = ms > 0.0 ? (double)n * 1000.0 / ms : 0.0;
+	double const eta = frac > 0.0 ? ms * (1.0 - frac) / frac / 1000.0
+	                              : -1.0;
+
+	char buf[160];
+	if (eta < 0.0)
+		(void)snprintf(buf, sizeof buf, "?");
+	else
+		(void)snprintf(buf, sizeof buf, "%" PRIu32 ":%02" PRIu32,
+		               (uint32_t)(eta + 0.5) / 60U,
+		               (uint32_t)(eta + 0.5) % 60U);
+	// On a terminal the line is redrawn over and the end of the last
+	// one is cleared, otherwise each report gets a line of its own
+	if (p->tty || !done)
+		(void)fprintf(stderr, "%s%5.1lf%%  %" PRIu64 " sequences  %"
+		              PRIu32 "/%" PRIu32 " tasks  %.0lf/s  ETA %s%s",
+		              p->tty ? "\r" : "", frac * 100.0, n, k,
+		              s->n_tasks, rate, buf, !p->tty ? "\n"
+		              : done ? "   \n" : "   ");
+
+	if (s->status_fd < 0)
+		return;
+
+	int const len = snprintf(buf, sizeof buf, "%s elapsed_ms=%.0lf"
+	                         " sequences=%" PRIu64 " tasks=%" PRIu32
+	                         " total_tasks=%" PRIu32 " percent=%.2lf"
+	                         " rate=%.0lf eta_s=%.0lf\n",
+	                         done ? "done" : "running", ms, n, k,
+	                         s->n_tasks, frac * 100.0, rate, eta);
+	if (len > 0 && (size_t)len < sizeof buf) {
+#ifndef _WIN32
+		ssize_t const w = write(s->status_fd, buf, (size_t)len);
+		(void)w;
+#else
+		(void)_write(s->status_fd, buf, (unsigned)len);
+#endif
+	}
+}
+
+#ifndef _WIN32
+static void *
+#else
+static unsigned __stdcall
+#endif
+progress_func (void *arg)
+{
+	struct progress *const p = arg;
+
+	for (uint32_t t = 0U; ; t += 50U) {
+#ifndef _WIN32
+		struct timespec const d = {.tv_nsec = 50000000L};
+		(void)nanosleep(&d, nullptr);
+#else
+		Sleep(50U);
+#endif
+		if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+			break;
+		if (t % PROGRESS_MS == PROGRESS_MS - 50U)
+			progress_report(p, false);
+	}
+
+#ifndef _WIN32
+	return nullptr;
+#else
+	_endthreadex(0);
+# ifdef _MSC_VER
+	return 0;
+# endif // _MSC_VER
+#endif // _WIN32
+}
+
+/**
+ * @brief Start the --progress reporter thread.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+progress_start (struct progress *const     p,
+                struct solver const *const s)
+{
+	p->s = s;
+	p->start = clock_ms();
+	p->total = 0U;
+	if (solver_exact(s) && !s->sym && s->n_tasks)
+		p->total = (uint64_t)s->tasks[s->n_tasks - 1U].end
+		           / sizeof *s->map / s->words;
+#ifndef _WIN32
+	p->tty = isatty(fileno(stderr));
+#else
+	p->tty = _isatty(_fileno(stderr));
+#endif
+	atomic_init(&p->stop, false);
+
+#ifndef _WIN32
+	return pthread_create(&p->tid, nullptr, progress_func, p);
+#else
+	p->tid = _beginthreadex(nullptr, 0, progress_func, p, 0, nullptr);
+	return p->tid ? 0 : errno;
+#endif
+}
+
+/**
+ * @brief Stop the --progress reporter thread and report once more.
+ */
+static void
+progress_stop (struct progress *const p)
+{
+	atomic_store_explicit(&p->stop, true, memory_order_relaxed);
+#ifndef _WIN32
+	(void)pthread_join(p->tid, nullptr);
+#else
+	(void)WaitForSingleObject((HANDLE)p->tid, INFINITE);
+	CloseHandle((HANDLE)p->tid);
+#endif
+	progress_report(p, true);
+}
+
+/**
+ * @brief Get a solver ready to run again.
+ */
+static void
+solver_reset (struct solver *s)
+{
+	s->write_next = s->ckpt.next;
+	s->task_next = s->ckpt.next;
+	s->active = 0U;
+	s->held = 0U;
+	for (uint32_t i = 0U; i < s->n_workers; ++i) {
+		struct worker *w = &s->workers[i];
+		w->stk.sum = 0U;
+		w->stk.stats = (struct scan_stats){0};
+		w->busy = w->idle = 0.0;
+		w->pieces = 0U;
+		w->count = 0U;
+		w->counts = (struct perf_count){0};
+		w->trace.len = 0U;
+		atomic_store_explicit(&w->found, 0U, memory_order_relaxed);
+	}
+	atomic_store_explicit(&s->finished, s->ckpt.next,
+	                      memory_order_relaxed);
+	s->write = (struct perf_count){0};
+	s->trace.len = 0U;
+	for (uint32_t i = 0U; i < s->n_tasks; ++i) {
+		struct piece *p = &s->tasks[i].head;
+		p->next = nullptr;
+		p->out = u64_view(nullptr, nullptr);
+		p->error = 0;
+		p->done = false;
+		s->tasks[i].ms = 0.0;
+		s->tasks[i].pieces = 0U;
+		s->tasks[i].count = 0U;
+		s->tasks[i].stats = (struct scan_stats){0};
+		s->tasks[i].perf = (struct perf_count){0};
+		if (i >= s->ckpt.next)
+			s->tasks[i].digest = (struct digest){0};
+	}
+}
+
+/**
+ * @brief Generate all sequences.
+ *
+ * Writes to @a f, or calls the output callback of @a s if it has one,
+ * unless the output is mapped. Either way, @a f can be a null pointer
+ * to discard the output.
+ *
+ * @param s     Solver.
+ * @param f     Output file.
+ * @param count Where to store the number of sequences generated.
+ * @return      0 on success, otherwise an error code. `EAGAIN` means
+ *              that no worker thread could be started.
+ */
+static int
+solver_run (struct solver *s,
+            FILE          *f,
+            uintptr_t     *count)
+{
+	int e = 0;
+	solver_reset(s);
+
+	// Find out on this thread whether there are counters to be had,
+	// and if not, just leave them out
+	struct perf perf = {0};
+	struct perf_count c0 = {0};
+	if (s->perf) {
+		int pe = perf_open(&perf);
+		if (pe) {
+			(void)fprintf(stderr, "perf_event_open: %s, continuing"
+			              " without counters%s\n",
+			              strerror(pe), pe == EACCES || pe == EPERM
+			              ? ", see /proc/sys/kernel/perf_event_paranoid"
+			              : "");
+			s->perf = false;
+		} else {
+			perf_read(&perf, &c0);
+		}
+	}
+
+	s->epoch = clock_ms();
+	uint32_t n_workers = solver_start_workers(s, worker_func);
+	trace_add(&s->trace, (struct trace_event){
+		.begin = s->epoch,
+		.end   = trace_clock(&s->trace),
+		.id    = UINT32_MAX,
+		.kind  = TRACE_START,
+	});
+	if (!n_workers) {
+		perf_close(&perf);
+		return EAGAIN;
+	}
+
+	struct progress prog;
+	if (s->progress) {
+		int pe = progress_start(&prog, s);
+		if (pe) {
+			(void)fprintf(stderr, "progress_start: %s\n", strerror(pe));
+			s->progress = false;
+		}
+	}
+
+	// Write out each task as soon as it and all before it are done.
+	// When the output is mapped, the first piece of every task is
+	// already in place, and only the pieces split off from it need
+	// to be copied after it.
+	//
+	// With symmetry reduction or packed output, each task is instead
+	// gathered into one buffer, to be completed with solver_finish()
+	// once all are done.
+	//
+	// Tasks saved in a checkpoint are already in the output.
+	uint64_t offset = s->ckpt.offset;
+	for (uint32_t i = s->ckpt.next; i < s->n_tasks; ++i) {
+		struct task *t = &s->tasks[i];
+		size_t const cap = (size_t)t->size * s->words;
+		size_t total = 0U;
+		uint64_t *buf = nullptr;
+		if ((s->sym || s->pack) && !e) {
+			double const t0 = trace_clock(&s->trace);
+			buf = malloc((cap ? cap : 1U) * sizeof *buf);
+			trace_add(&s->trace, (struct trace_event){
+				.begin = t0,
+				.end   = trace_clock(&s->trace),
+				.arg   = (cap ? cap : 1U) * sizeof *buf,
+				.id    = i,
+				.kind  = TRACE_ALLOC,
+			});
+			if (!buf) {
+				e = errno ? errno : ENOMEM;
+				perror("malloc");
+			}
+		}
+		for (struct piece *p = &t->head, *next; p; p = next) {
+			struct u64_view v = u64_view(nullptr, nullptr);
+			uint64_t n = 0U;
+			int pe = solver_collect(s, p, &v, &n, &next);
+			size_t len = u64_view_len(v);
+			double const t0 = trace_clock(&s->trace);
+			if (!pe && t->size && total + n * s->words > cap)
+				pe = EPROTO;
+			bool const put = !pe && !e && len &&
+			                 (buf || (s->map && p != &t->head) ||
+			                  f || s->batch);
+			if (pe) {
+				if (!e) {
+					e = pe;
+					(void)fprintf(stderr, "piece_solve: %s\n",
+					              strerror(e));
+				}
+			} else if (buf && !e && len) {
+				(void)memcpy(&buf[total], v.begin[0],
+				             len * sizeof *buf);
+			} else if (s->map && p != &t->head && !e && len) {
+				(void)memcpy(&s->map[solver_offset(s, i) + total],
+				             v.begin[0], len * sizeof *s->map);
+			} else if ((f || s->batch) && !e && len) {
+				e = solver_emit(s, f, v.begin[0], len);
+			}
+			if (put) {
+				trace_add(&s->trace, (struct trace_event){
+					.begin = t0,
+					.end   = trace_clock(&s->trace),
+					.arg   = len * sizeof *buf,
+					.id    = i,
+					.kind  = TRACE_WRITE,
+				});
+			}
+			total += (size_t)n * s->words;
+			if (s->digest && !s->sym && !s->pack && !pe)
+				t->digest = digest_cat(t->digest, p->digest);
+			if (p != &t->head) {
+				free(v.begin[0]);
+				free(p);
+			} else if (!s->map) {
+				free(v.begin[0]);
+			}
+		}
+		if (buf) {
+			t->head.out = u64_view(buf, buf + total);
+		} else if (!e && t->exact && total != cap) {
+			e = EPROTO;
+			(void)fprintf(stderr, "piece_solve: %s\n", strerror(e));
+		}
+		offset += total * sizeof *buf;
+		if (s->ckpt.journal && !e)
+			e = checkpoint_task(s, f, i, offset);
+		solver_release(s, i);
+	}
+
+	double const t0 = trace_clock(&s->trace);
+	*count = solver_wait_workers(s, n_workers);
+	trace_add(&s->trace, (struct trace_event){
+		.begin = t0,
+		.end   = trace_clock(&s->trace),
+		.id    = UINT32_MAX,
+		.kind  = TRACE_JOIN,
+	});
+	if ((s->sym || s->pack) && !e)
+		e = solver_finish(s, f, count);
+
+	if (s->progress)
+		progress_stop(&prog);
+
+	if (s->perf) {
+		struct perf_count c1;
+		perf_read(&perf, &c1);
+		perf_add(&s->write, &c0, &c1);
+		perf_close(&perf);
+	}
+
+	return e;
+}
+
+static int
+solver_solve (struct solver *s,
+              char const    *out,
+              bool           map)
+{
+	FILE *f = nullptr;
+	size_t const size = s->n_tasks
+	                    ? (size_t)s->tasks[s->n_tasks - 1U].end : 0U;
+	if (out && map && !solver_exact(s)) {
+		(void)fprintf(stderr, "Output size isn't known in advance,"
+		              " can't map output file\n");
+		return EINVAL;
+	}
+	if (out && map && size) {
+		s->map = output_map(out, size);
+		if (!s->map)
+			return errno ? errno : EIO;
+	} else if (out && s->ckpt.dir) {
+		f = checkpoint_open(s, out);
+		if (!f)
+			return errno ? errno : EIO;
+	} else if (out) {
+		f = output_open(out);
+		if (!f)
+			return errno ? errno : EIO;
+		if (f == stdout)
+			out = nullptr;
+	}
+
+	// A resumed shard already has its header
+	int e = 0;
+	if (f && s->shard.count && !s->ckpt.resume) {
+		e = shard_write_head(f, &s->shard);
+		if (e)
+			(void)fprintf(stderr, "shard_write_head: %s\n",
+			              strerror(e));
+	}
+
+	double const t1 = clock_ms();
+	uintptr_t seq_count = 0U;
+	if (!e)
+		e = solver_run(s, f, &seq_count);
+	if (e != EAGAIN)
+		(void)fprintf(stderr, "%s %zu sequences in %.3lf ms\n",
+		              s->sink == SINK_STORE ? "Generated" : "Counted",
+		              seq_count, clock_ms() - t1);
+
+	// Only a complete shard gets its size, so that merging can tell
+	// one that was cut short
+	if (!e && f && s->shard.count) {
+		struct shard h = s->shard;
+		e = fflush(f) ? errno ? errno : EIO : file_size(f, &h.bytes);
+		if (!e) {
+			h.bytes -= SHARD_HEAD_SIZE;
+			h.done = true;
+			rewind(f);
+			e = shard_write_head(f, &h);
+		}
+		if (!e && fflush(f))
+			e = errno ? errno : EIO;
+		if (e)
+			(void)fprintf(stderr, "shard_write_head: %s\n",
+			              strerror(e));
+	}
+
+	if (!e && s->sink == SINK_CHECKSUM) {
+		uint64_t sum = 0U;
+		for (uint32_t i = 0U; i < s->n_workers; ++i)
+			sum += s->workers[i].stk.sum;
+		(void)fprintf(stderr, "Checksum %016" PRIx64 "\n", sum);
+	}
+
+	if (s->map) {
+		output_unmap(s->map, size);
+		s->map = nullptr;
+		if (e)
+			(void)remove(out);
+	} else if (f && out) {
+		if (fclose(f) && !e) {
+			e = errno ? errno : EIO;
+			perror("fclose");
+		}
+		// What was saved is kept for --resume
+		if (e && !s->ckpt.journal)
+			(void)remove(out);
+	}
+
+	if (s->ckpt.journal) {
+		(void)fclose(s->ckpt.journal);
+		s->ckpt.journal = nullptr;
+	}
+
+	return e;
+}
+
+static int
+stats_cmp (void const *a,
+           void const *b)
+{
+	double const x = (*(struct task const *const *)a)->ms;
+	double const y = (*(struct task const *const *)b)->ms;
+	return (x < y) - (x > y);
+}
+
+/**
+ * @brief Write one row of the --stats CSV file.
+ *
+ * The hardware counters @a pc are only written with --perf.
+ */
+static void
+stats_row (FILE                    *f,
+           char const              *kind,
+           uint32_t                 id,
+           struct task const       *t,
+           double                   ms,
+           double                   idle,
+           uint32_t                 pieces,
+           uint64_t                 count,
+           struct scan_stats const *st,
+           struct perf_count const *pc)
+{
+	(void)fprintf(f, "%s,%" PRIu32 ",", kind, id);
+	if (t) {
+		uint32_t bits = 0U;
+		uint64_t const v = task_prefix(t, &bits);
+		(void)fprintf(f, "%" PRIx64 "/%" PRIu32, v, bits);
+	}
+	(void)fprintf(f, ",%.3lf,", ms);
+	if (!t)
+		(void)fprintf(f, "%.3lf", idle);
+	(void)fprintf(f, ",%" PRIu32 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+	              ",%" PRIu64, pieces, count, st->valid, st->invalid,
+	              st->found);
+	for (size_t i = 0U; i < countof(st->nodes); ++i)
+		(void)fprintf(f, ",%" PRIu64, st->nodes[i]);
+	for (size_t i = 0U; pc && i < countof(pc->v); ++i)
+		(void)fprintf(f, ",%" PRIu64, pc->v[i]);
+	(void)fputc('\n', f);
+}
+
+/**
+ * @brief Report the statistics collected with --stats.
+ *
+ * Prints a summary of the search counters, the time each worker spent
+ * searching and waiting, and the slowest tasks. The task times are the
+ * sum of the times of their pieces, so a task that was split up among
+ * several workers can take longer than the whole run. With a file name
+ * every task and worker is also written to it as a row of CSV.
+ *
+ * @param s   Solver.
+ * @param csv CSV file name, a dash for standard output, or a null
+ *            pointer.
+ * @return    0 on success, otherwise an error code.
+ */
+static int
+solver_stats (struct solver const *const s,
+              char const *const          csv)
+{
+	struct scan_stats sum = s->above;
+	for (uint32_t i = 0U; i < s->n_tasks; ++i) {
+		struct scan_stats const *const st = &s->tasks[i].stats;
+		for (size_t j = 0U; j < countof(sum.nodes); ++j)
+			sum.nodes[j] += st->nodes[j];
+		sum.valid += st->valid;
+		sum.invalid += st->invalid;
+		sum.found += st->found;
+	}
+
+	if (s->scan) {
+		(void)fprintf(stderr, "Level  Candidates searched\n");
+		for (size_t j = 0U; j < countof(sum.nodes); ++j)
+			(void)fprintf(stderr, "%5zu  %19" PRIu64 "\n",
+			              j, sum.nodes[j]);
+		(void)fprintf(stderr, "Valid candidates %" PRIu64 ", invalid %"
+		              PRIu64 ", complete sequences %" PRIu64 "\n",
+		              sum.valid, sum.invalid, sum.found);
+	}
+
+	(void)fprintf(stderr, "Worker    Busy ms    Idle ms  Pieces"
+	              "   Sequences\n");
+	for (uint32_t i = 0U; i < s->n_workers; ++i) {
+		struct worker const *const w = &s->workers[i];
+		(void)fprintf(stderr, "%6" PRIu32 " %10.3lf %10.3lf %7" PRIu32
+		              " %11" PRIu64 "\n", i, w->busy, w->idle,
+		              w->pieces, w->count);
+	}
+
+	struct task const **t = malloc((s->n_tasks ? s->n_tasks : 1U)
+	                               * sizeof *t);
+	if (!t) {
+		int e = errno ? errno : ENOMEM;
+		perror("malloc");
+		return e;
+	}
+	for (uint32_t i = 0U; i < s->n_tasks; ++i)
+		t[i] = &s->tasks[i];
+	qsort(t, s->n_tasks, sizeof *t, stats_cmp);
+
+	if (s->n_tasks) {
+		(void)fprintf(stderr, "Task times: max %.3lf ms, median %.3lf"
+		              " ms, min %.3lf ms\n  Task  Prefix"
+		              "                     ms  Pieces   Sequences\n",
+		              t[0]->ms, t[s->n_tasks / 2U]->ms,
+		              t[s->n_tasks - 1U]->ms);
+	}
+	for (uint32_t i = 0U; i < s->n_tasks && i < 5U; ++i) {
+		uint32_t bits = 0U;
+		uint64_t const v = task_prefix(t[i], &bits);
+		char buf[24];
+		(void)snprintf(buf, sizeof buf, "%" PRIx64 "/%" PRIu32,
+		               v, bits);
+		(void)fprintf(stderr, "%6" PRIu32 "  %-20s %10.3lf %7" PRIu32
+		              " %11" PRIu64 "\n",
+		              (uint32_t)(t[i] - s->tasks), buf, t[i]->ms,
+		              t[i]->pieces, t[i]->count);
+	}
+	free(t);
+
+	if (!csv)
+		return 0;
+
+	bool const out = !(csv[0] == '-' && !csv[1]);
+	FILE *f = out ? fopen(csv, "w") : stdout;
+	if (!f) {
+		int e = errno ? errno : EIO;
+		perror("fopen");
+		return e;
+	}
+
+	(void)fputs("kind,id,prefix,ms,idle_ms,pieces,sequences,valid,"
+	            "invalid,found", f);
+	for (size_t j = 0U; j < countof(sum.nodes); ++j)
+		(void)fprintf(f, ",nodes%zu", j);
+	if (s->perf)
+		(void)fputs(",cycles,instructions,branch_misses,l1d_misses", f);
+	(void)fputc('\n', f);
+	for (uint32_t i = 0U; i < s->n_tasks; ++i) {
+		struct task const *const k = &s->tasks[i];
+		stats_row(f, "task", i, k, k->ms, 0.0, k->pieces, k->count,
+		          &k->stats, s->perf ? &k->perf : nullptr);
+	}
+	for (uint32_t i = 0U; i < s->n_workers; ++i) {
+		struct worker const *const w = &s->workers[i];
+		stats_row(f, "worker", i, nullptr, w->busy, w->idle,
+		          w->pieces, w->count, &w->stk.stats,
+		          s->perf ? &w->counts : nullptr);
+	}
+
+	int e = ferror(f) ? errno ? errno : EIO : 0;
+	if (out && fclose(f) && !e)
+		e = errno ? errno : EIO;
+	if (e)
+		(void)fprintf(stderr, "%s: %s\n", csv, strerror(e));
+	return e;
+}
+
+static int
+perf_cmp (void const *a,
+          void const *b)
+{
+	uint64_t const x = (*(struct task const *const *)a)->perf.v[PERF_CYCLES];
+	uint64_t const y = (*(struct task const *const *)b)->perf.v[PERF_CYCLES];
+	return (x < y) - (x > y);
+}
+
+/**
+ * @brief Print one row of the --perf tables.
+ */
+static void
+perf_row (char const              *label,
+          struct perf_count const *c)
+{
+	uint64_t const cyc = c->v[PERF_CYCLES];
+	uint64_t const ins = c->v[PERF_INSTRUCTIONS];
+	uint64_t const bm = c->v[PERF_BRANCH_MISSES];
+	(void)fprintf(stderr, "%-20s %14" PRIu64 " %14" PRIu64 " %5.2lf %12"
+	              PRIu64 " %6.2lf %12" PRIu64 "\n", label, cyc, ins,
+	              cyc ? (double)ins / (double)cyc : 0.0, bm,
+	              ins ? (double)bm * 1000.0 / (double)ins : 0.0,
+	              c->v[PERF_L1D_MISSES]);
+}
+
+/**
+ * @brief Report the hardware events counted with --perf.
+ *
+ * Prints the cycles, instructions, instructions per cycle, branch
+ * mispredictions in total and per thousand instructions, and L1 data
+ * cache misses of each worker while searching, of this thread while
+ * writing out the results, and of the tasks that took the most cycles.
+ * Events that the CPU doesn't count show up as zeros.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+solver_perf (struct solver const *const s)
+{
+	if (!s->perf)
+		return 0;
+
+	struct task const **t = malloc((s->n_tasks ? s->n_tasks : 1U)
+	                               * sizeof *t);
+	if (!t) {
+		int e = errno ? errno : ENOMEM;
+		perror("malloc");
+		return e;
+	}
+	for (uint32_t i = 0U; i < s->n_tasks; ++i)
+		t[i] = &s->tasks[i];
+	qsort(t, s->n_tasks, sizeof *t, perf_cmp);
+
+	char buf[32];
+	struct perf_count sum = {0};
+	(void)fprintf(stderr, "                             Cycles   Instructions"
+	              "   IPC  Br. misses   MPKI  L1D misses\n");
+	for (uint32_t i = 0U; i < s->n_workers; ++i) {
+		struct perf_count const *const c = &s->workers[i].counts;
+		for (size_t j = 0U; j < countof(sum.v); ++j)
+			sum.v[j] += c->v[j];
+		(void)snprintf(buf, sizeof buf, "Worker %" PRIu32, i);
+		perf_row(buf, c);
+	}
+	perf_row("All workers", &sum);
+	perf_row("Writing", &s->write);
+
+	for (uint32_t i = 0U; i < s->n_tasks && i < 5U; ++i) {
+		uint32_t bits = 0U;
+		uint64_t const v = task_prefix(t[i], &bits);
+		(void)snprintf(buf, sizeof buf, "Task %" PRIu32 " %" PRIx64
+		               "/%" PRIu32, (uint32_t)(t[i] - s->tasks),
+		               v, bits);
+		perf_row(buf, &t[i]->perf);
+	}
+	free(t);
+
+	return 0;
+}
+
+static char const *const trace_names[] = {
+	[TRACE_THREAD] = "thread",
+	[TRACE_IDLE]   = "idle",
+	[TRACE_PIECE]  = "search",
+	[TRACE_FINISH] = "finish",
+	[TRACE_ALLOC]  = "alloc",
+	[TRACE_START]  = "start workers",
+	[TRACE_WRITE]  = "write",
+	[TRACE_JOIN]   = "join workers",
+};
+
+/**
+ * @brief Write the events of one thread as Chrome trace events.
+ *
+ * @param f     Output file.
+ * @param t     Event log.
+ * @param tid   Thread number in the trace.
+ * @param epoch Time zero of the trace.
+ */
+static void
+trace_write (FILE               *f,
+             struct trace const *t,
+             uint32_t            tid,
+             double              epoch)
+{
+	for (uint64_t i = trace_first(t); i < t->len; ++i) {
+		struct trace_event const *const ev = &t->ev[i & (TRACE_LEN - 1U)];
+		(void)fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+		              "\"tid\":%" PRIu32 ",\"ts\":%.3lf,\"dur\":%.3lf,"
+		              "\"args\":{", trace_names[ev->kind], tid,
+		              (ev->begin - epoch) * 1000.0,
+		              (ev->end - ev->begin) * 1000.0);
+		char const *sep = "";
+		if (ev->id != UINT32_MAX) {
+			(void)fprintf(f, "\"task\":%" PRIu32, ev->id);
+			sep = ",";
+		}
+		if (ev->kind == TRACE_PIECE || ev->kind == TRACE_FINISH)
+			(void)fprintf(f, "%s\"prefix\":\"%" PRIx64 "/%" PRIu32
+			              "\"", sep, ev->arg, (uint32_t)ev->bits);
+		if (ev->kind == TRACE_PIECE)
+			(void)fprintf(f, ",\"split\":%s",
+			              ev->split ? "true" : "false");
+		if (ev->kind == TRACE_ALLOC || ev->kind == TRACE_WRITE)
+			(void)fprintf(f, "%s\"bytes\":%" PRIu64, sep, ev->arg);
+		(void)fputs("}}", f);
+	}
+}
+
+/**
+ * @brief Save the events logged with --trace.
+ *
+ * The file is in the Chrome trace event format, which Perfetto and
+ * chrome://tracing can open. Each worker and this thread is a track of
+ * its own. Events that didn't fit in the logs are left out, and how
+ * many of them there were is printed.
+ *
+ * @param s    Solver.
+ * @param path File name, or a dash for standard output.
+ * @return     0 on success, otherwise an error code.
+ */
+static int
+solver_trace (struct solver const *const s,
+              char const *const          path)
+{
+	bool const out = !(path[0] == '-' && !path[1]);
+	FILE *f = out ? fopen(path, "w") : stdout;
+	if (!f) {
+		int e = errno ? errno : EIO;
+		perror("fopen");
+		return e;
+	}
+
+	uint64_t lost = trace_first(&s->trace);
+	(void)fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+	            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+	            "\"args\":{\"name\":\"dbs26\"}},\n"
+	            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+	            "\"tid\":0,\"args\":{\"name\":\"main\"}}", f);
+	for (uint32_t i = 0U; i < s->n_workers; ++i) {
+		(void)fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+		              "\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":"
+		              "\"worker %" PRIu32 "\"}}", i + 1U, i);
+		lost += trace_first(&s->workers[i].trace);
+	}
+	trace_write(f, &s->trace, 0U, s->epoch);
+	for (uint32_t i = 0U; i < s->n_workers; ++i)
+		trace_write(f, &s->workers[i].trace, i + 1U, s->epoch);
+	(void)fprintf(f, "\n],\"otherData\":{\"lost\":%" PRIu64 "}}\n", lost);
+
+	if (lost)
+		(void)fprintf(stderr, "Left out the %" PRIu64 " oldest events"
+		              " that didn't fit in the trace\n", lost);
+
+	int e = ferror(f) ? errno ? errno : EIO : 0;
+	if (out && fclose(f) && !e)
+		e = errno ? errno : EIO;
+	if (e)
+		(void)fprintf(stderr, "%s: %s\n", path, strerror(e));
+	return e;
+}
+
+/**
+ * @brief Save the digests of the tasks of the last run.
+ *
+ * The digests are written as text, one line per task, which gives the
+ * task, its prefix, its byte offset and size in raw output, and its
+ * digest. The last line has the size and the digest of all of it.
+ * With --format packed the digests are still of the raw sequences,
+ * so they are also those of the output of --unpack.
+ *
+ * @param s    Solver.
+ * @param path File name, or a dash for standard output.
+ * @return     0 on success, otherwise an error code.
+ */
+static int
+solver_digest (struct solver const *const s,
+               char const *const          path)
+{
+	bool const out = !(path[0] == '-' && !path[1]);
+	FILE *f = out ? fopen(path, "w") : stdout;
+	if (!f) {
+		int e = errno ? errno : EIO;
+		perror("fopen");
+		return e;
+	}
+
+	struct digest all = {0};
+	(void)fprintf(f, "# dbs26 order %" PRIu32 " digests\n"
+	              "# task prefix offset bytes digest\n", s->order);
+	for (uint32_t i = 0U; i < s->n_tasks; ++i) {
+		struct digest const d = s->tasks[i].digest;
+		uint32_t bits = 0U;
+		uint64_t const v = task_prefix(&s->tasks[i], &bits);
+		(void)fprintf(f, "%" PRIu32 " %0*" PRIx64 "/%" PRIu32 " %" PRIu64
+		              " %" PRIu64 " %016" PRIx64 "\n", i,
+		              (int)(bits + 3U) / 4, v, bits,
+		              all.len * sizeof *s->map, d.len * sizeof *s->map,
+		              d.hash);
+		all = digest_cat(all, d);
+	}
+	(void)fprintf(f, "total %" PRIu64 " %016" PRIx64 "\n",
+	              all.len * sizeof *s->map, all.hash);
+	(void)fprintf(stderr, "Digest %016" PRIx64 "\n", all.hash);
+
+	int e = ferror(f) ? errno ? errno : EIO : 0;
+	if (out && fclose(f) && !e)
+		e = errno ? errno : EIO;
+	if (e)
+		(void)fprintf(stderr, "%s: %s\n", path, strerror(e));
+	return e;
+}
+
+/**
+ * @brief Find the cache entry of a candidate, or the free entry where
+ *        it would go.
+ */
+static struct memo *
+memo_slot (struct solver const *const s,
+           uint64_t const             c)
+{
+	uint32_t h = (uint32_t)((c * UINT64_C(0x9e3779b97f4a7c15))
+	                        >> (64U - MEMO_BITS));
+	while (s->memo[h].seq && s->memo[h].seq != c)
+		h = (h + 1U) & (MEMO_LEN - 1U);
+	return &s->memo[h];
+}
+
+/**
+ * @brief Count the sequences under a candidate of the search.
+ *
+ * Searches the subtree without storing it, unless the count is cached.
+ *
+ * @param s   Solver.
+ * @param stk Search state.
+ * @param c   Candidate, which mustn't be on the last level.
+ * @param m   Windows used by @a c.
+ * @param sp  Level of @a c.
+ * @return    Number of sequences that begin with @a c.
+ */
+static uint64_t
+unrank_count (struct solver *const s,
+              struct stk *const    stk,
+              uint64_t const       c,
+              uint64_t const       m,
+              uint32_t const       sp)
+{
+	struct memo *const slot = sp < MEMO_LEVELS ? memo_slot(s, c) : nullptr;
+	if (slot && slot->seq)
+		return slot->count;
+
+	uint64_t const seq = c << SUB_LEN;
+	stk->sp = stk->top = sp + 1U;
+	uint64_t const n = s->count(stk, nullptr, seq + count_lsb_1(m),
+	                            seq + SUB_LAST - count_msb_1(m), m);
+
+	// Keep a quarter of the table free to end the probe sequences
+	if (slot && s->memo_len < MEMO_LEN / 4U * 3U) {
+		*slot = (struct memo){.seq = c, .count = n};
+		s->memo_len++;
+	}
+
+	return n;
+}
+
+/**
+ * @brief Output the first @a n sequences under candidates @a seq to
+ *        @a end of level @a sp.
+ *
+ * Searches the subtree of one candidate at a time and outputs as much
+ * of it as is needed. Only when a cached count shows that a subtree
+ * has more than that does it descend instead, so the sequences that
+ * are searched for nothing are at most those of one uncached subtree.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+unrank_head (struct solver *const s,
+             struct stk *const    stk,
+             FILE *const          f,
+             uint64_t             seq,
+             uint64_t const       end,
+             uint64_t const       map,
+             uint32_t const       sp,
+             uint64_t *const      n)
+{
+	if (sp == countof(stk->stk) - 1U) {
+		uint64_t v[SEQ_LEN];
+		uint32_t const k = scan_leaf(stk, v, seq, end, map,
+		                             SINK_STORE, false);
+		size_t const len = k < *n ? k : (size_t)*n;
+		*n -= len;
+		return solver_emit(s, f, v, len);
+	}
+
+	int e = 0;
+	uint64_t ext = scan_ext(seq, end, map);
+	for (seq = seq >> SUB_LEN << SUB_LEN; *n && !e && ext; ext &= ext - 1U) {
+		uint64_t const c = seq | count_lsb_1(~ext);
+		uint64_t const m = map | window_bits(c, SUB_LEN);
+		uint64_t const d = c << SUB_LEN;
+		uint64_t const lo = d + count_lsb_1(m);
+		uint64_t const hi = d + SUB_LAST - count_msb_1(m);
+
+		struct memo const *const slot = sp < MEMO_LEVELS
+		                                ? memo_slot(s, c) : nullptr;
+		if (slot && slot->seq && slot->count > *n)
+			return unrank_head(s, stk, f, lo, hi, m, sp + 1U, n);
+
+		stk->sp = stk->top = sp + 1U;
+		size_t k = s->scan(stk, s->scratch, lo, hi, m);
+		k = k < *n ? k : (size_t)*n;
+		*n -= k;
+		e = solver_emit(s, f, s->scratch, k);
+	}
+
+	return e;
+}
+
+/**
+ * @brief Check whether solver_unrank() can be used.
+ */
+static bool
+solver_indexed (struct solver const *s)
+{
+	return s->scan && !s->sym && !s->pack && solver_exact(s);
+}
+
+/**
+ * @brief Generate the sequences from index @a first onward without
+ *        generating the ones before them.
+ *
+ * The task tables give the task that holds sequence @a first. From its
+ * root, the search descends into the one candidate on each level that
+ * the sequence descends from, skipping the ones before it by counting
+ * their sequences. That takes a fraction of a task's worth of search,
+ * and the counts of the upper levels are cached for later calls. The
+ * rest of the candidates on the path, and the tasks after it, are then
+ * searched in order until @a n sequences are output. All of this is
+ * done on the calling thread.
+ *
+ * Needs an order 6 engine and exact task sizes, which means a prefix
+ * and split depth of at most 15 bits, and no --symmetry or packed
+ * output.
+ *
+ * @param s     Solver.
+ * @param f     Output file, or a null pointer to only benchmark or to
+ *              use the callback.
+ * @param first Index of the first sequence.
+ * @param n     Number of sequences.
+ * @return      0 on success, otherwise an error code.
+ */
+static int
+solver_unrank (struct solver *const s,
+               FILE *const          f,
+               uint64_t const       first,
+               uint64_t             n)
+{
+	if (!solver_indexed(s))
+		return ENOTSUP;
+
+	uint64_t const total = solver_offset(s, s->n_tasks);
+	if (first > total || n > total - first)
+		return ERANGE;
+	if (!n)
+		return 0;
+
+	if (!s->memo) {
+		uint64_t max = 0U;
+		for (uint32_t i = 0U; i < s->n_tasks; ++i)
+			max = s->tasks[i].size > max ? s->tasks[i].size : max;
+		s->scratch = malloc((size_t)max * sizeof *s->scratch);
+		s->memo = calloc(MEMO_LEN, sizeof *s->memo);
+		if (!s->scratch || !s->memo) {
+			free(s->scratch);
+			free(s->memo);
+			s->scratch = nullptr;
+			s->memo = nullptr;
+			return ENOMEM;
+		}
+		s->memo_len = 0U;
+	}
+
+	// Last task that begins at or before the first sequence
+	uint32_t lo = 0U, hi = s->n_tasks;
+	while (hi - lo > 1U) {
+		uint32_t mid = lo + (hi - lo) / 2U;
+		if (solver_offset(s, mid) <= first)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	struct stk stk = s->workers[0].stk;
+	stk.split = false;
+	struct task const *t = &s->tasks[lo];
+	uint32_t const leaf = countof(stk.stk) - 1U;
+	struct u64_pair path[countof(stk.stk)];
+	uint64_t at[countof(stk.stk)];
+	uint64_t r = first - solver_offset(s, lo);
+	uint64_t size = t->size;
+	uint64_t seq = t->head.seq, end = t->head.end, map = t->head.map;
+	uint32_t sp = t->head.sp;
+	int e = 0;
+
+	for (;; ++sp) {
+		if (sp == leaf) {
+			uint64_t v[SEQ_LEN];
+			uint32_t const k = scan_leaf(&stk, v, seq, end, map,
+			                             SINK_STORE, false);
+			if (r >= k)
+				return EPROTO;
+			size_t const len = k - r < n ? (size_t)(k - r) : (size_t)n;
+			e = solver_emit(s, f, &v[r], len);
+			n -= len;
+			break;
+		}
+
+		// Count from whichever end of the level is closer
+		bool const back = r >= size / 2U;
+		uint64_t i = back ? size - 1U - r : r;
+		uint64_t ext = scan_ext(seq, end, map), c = 0U, m = 0U;
+		for (seq = seq >> SUB_LEN << SUB_LEN; ext; ) {
+			uint64_t const x = back ? SUB_LAST - count_msb_1(~ext)
+			                        : count_lsb_1(~ext);
+			c = seq | x;
+			m = map | window_bits(c, SUB_LEN);
+			ext &= ~(UINT64_C(1) << x);
+			size = unrank_count(s, &stk, c, m, sp);
+			if (i < size)
+				break;
+			i -= size;
+		}
+		if (!ext && i >= size)
+			return EPROTO;
+		r = back ? size - 1U - i : i;
+
+		path[sp] = (struct u64_pair){.end = end, .map = map};
+		at[sp] = c;
+		seq = c << SUB_LEN;
+		end = seq + SUB_LAST - count_msb_1(m);
+		seq += count_lsb_1(m);
+		map = m;
+	}
+
+	// The candidates after the path, deepest level first
+	for (uint32_t l = leaf; n && !e && l-- > t->head.sp; ) {
+		if (at[l] != path[l].end)
+			e = unrank_head(s, &stk, f, at[l] + 1U, path[l].end,
+			                path[l].map, l, &n);
+	}
+
+	for (uint32_t i = lo + 1U; n && !e && i < s->n_tasks; ++i) {
+		t = &s->tasks[i];
+		e = unrank_head(s, &stk, f, t->head.seq, t->head.end,
+		                t->head.map, t->head.sp, &n);
+	}
+
+	return e;
+}
+
+/**
+ * @brief Output sequences by index, see solver_unrank().
+ *
+ * @param s     Solver.
+ * @param out   Output file, or a null pointer to only benchmark.
+ * @param range Index of the first sequence and one past the last one,
+ *              which is clamped to the end of the set.
+ * @return      0 on success, otherwise an error code.
+ */
+static int
+solver_select (struct solver  *s,
+               char const     *out,
+               uint64_t const *range)
+{
+	if (!solver_indexed(s)) {
+		(void)fprintf(stderr, "Selecting by index needs an order 6"
+		              " engine, and a prefix and split depth of at"
+		              " most 15 bits\n");
+		return ENOTSUP;
+	}
+
+	uint64_t const total = solver_offset(s, s->n_tasks);
+	uint64_t const end = range[1] < total ? range[1] : total;
+	if (range[0] > end || (range[1] != UINT64_MAX && range[1] > total)) {
+		(void)fprintf(stderr, "There are %" PRIu64 " sequences\n",
+		              total);
+		return ERANGE;
+	}
+
+	FILE *f = nullptr;
+	if (out) {
+		f = output_open(out);
+		if (!f)
+			return errno ? errno : EIO;
+		if (f == stdout)
+			out = nullptr;
+	}
+
+	double const t1 = clock_ms();
+	int e = solver_unrank(s, f, range[0], end - range[0]);
+	if (e)
+		(void)fprintf(stderr, "solver_unrank: %s\n", strerror(e));
+	else
+		(void)fprintf(stderr, "Generated %" PRIu64 " sequences"
+		              " in %.3lf ms\n", end - range[0],
+		              clock_ms() - t1);
+
+	if (f && out) {
+		if (fclose(f) && !e) {
+			e = errno ? errno : EIO;
+			perror("fclose");
+		}
+		if (e)
+			(void)remove(out);
+	}
+
+	return e;
+}
+
+// Sequences sampled per block
+#define SAMPLE_BLOCK 4096U
+
+/**
+ * @brief A block of sampled sequences waiting to be written.
+ */
+struct sample_slot {
+	uint64_t *buf;
+	bool      done;
+};
+
+/**
+ * @brief State of solver_sample().
+ */
+struct sampler {
+	uint64_t           seed;
+	uint64_t           count;   //!< Number of sequences to sample
+	uint64_t           blocks;  //!< Number of blocks to sample
+	uint64_t           next;    //!< Next block to sample
+	uint64_t           written; //!< Number of blocks written out
+	uint32_t           slots;
+	struct sample_slot slot[];
+};
+
+#ifndef _WIN32
+static void *
+#else
+static unsigned __stdcall
+#endif
+sample_func (void *arg)
+{
+	struct worker *w = arg;
+	struct solver *s = container_of(w, struct solver, workers[w->id]);
+	struct sampler *const p = s->sampler;
+	unsigned count = 0U;
+
+	for (;;) {
+		lock_acquire(&s->lock);
+		while (p->next < p->blocks && p->next - p->written >= p->slots)
+			lock_wait(&s->lock);
+		uint64_t id = p->next < p->blocks ? p->next++ : UINT64_MAX;
+		lock_release(&s->lock);
+		if (id == UINT64_MAX)
+			break;
+
+		// One stream per block keeps the output independent of
+		// the number of threads
+		struct sample_slot *b = &p->slot[id % p->slots];
+		uint64_t n = p->count - id * SAMPLE_BLOCK;
+		n = n < SAMPLE_BLOCK ? n : SAMPLE_BLOCK;
+		struct rng r;
+		rng_init(&r, p->seed, id);
+		for (uint64_t i = 0U; i < n; ++i)
+			order_sample(&b->buf[i * s->words], s->order, &r);
+		count += (unsigned)n;
+
+		lock_acquire(&s->lock);
+		b->done = true;
+		lock_wake(&s->lock);
+		lock_release(&s->lock);
+	}
+
+#ifndef _WIN32
+	return (void *)(uintptr_t)count;
+#else
+	_endthreadex(count);
+# ifdef _MSC_VER
+	return count;
+# endif // _MSC_VER
+#endif // _WIN32
+}
+
+/**
+ * @brief Output sequences picked uniformly at random.
+ *
+ * Unlike the search, this works for every order, since each sample is
+ * built directly by order_sample(). The samples are made in blocks of
+ * @ref SAMPLE_BLOCK, each with its own random number stream seeded
+ * from @a seed and the block number, so a seed always gives the same
+ * output. The workers take blocks in order and this thread writes them
+ * out, with at most two blocks per worker in memory at a time.
+ *
+ * @param s     Solver.
+ * @param out   Output file name, or a null pointer to only benchmark.
+ * @param count Number of sequences to sample.
+ * @param seed  Random seed.
+ * @return      0 on success, otherwise an error code.
+ */
+static int
+solver_sample (struct solver *s,
+               char const    *out,
+               uint64_t       count,
+               uint64_t       seed)
+{
+	uint32_t const slots = 2U * s->n_workers;
+	size_t const len = (size_t)SAMPLE_BLOCK * s->words;
+	struct sampler *p = calloc(1U, offsetof(struct sampler, slot[slots]));
+	int e = p ? 0 : errno ? errno : ENOMEM;
+	for (uint32_t i = 0U; !e && i < slots; ++i) {
+		p->slot[i].buf = malloc(len * sizeof *p->slot[i].buf);
+		if (!p->slot[i].buf)
+			e = errno ? errno : ENOMEM;
+	}
+	if (e) {
+		perror("malloc");
+		goto free_sampler;
+	}
+
+	p->seed = seed;
+	p->count = count;
+	p->blocks = count / SAMPLE_BLOCK + !!(count % SAMPLE_BLOCK);
+	p->slots = slots;
+	s->sampler = p;
+
+	FILE *f = nullptr;
+	if (out) {
+		f = output_open(out);
+		if (!f) {
+			e = errno ? errno : EIO;
+			goto free_sampler;
+		}
+		if (f == stdout)
+			out = nullptr;
+	}
+
+	double const t1 = clock_ms();
+	uint32_t n_workers = solver_start_workers(s, sample_func);
+	if (!n_workers) {
+		e = EAGAIN;
+		goto close_output;
+	}
+
+	for (uint64_t id = 0U; id < p->blocks; ++id) {
+		struct sample_slot *b = &p->slot[id % slots];
+		lock_acquire(&s->lock);
+		while (!b->done)
+			lock_wait(&s->lock);
+		lock_release(&s->lock);
+
+		uint64_t n = count - id * SAMPLE_BLOCK;
+		n = n < SAMPLE_BLOCK ? n : SAMPLE_BLOCK;
+		e = solver_emit(s, f, b->buf, (size_t)n * s->words);
+
+		// On error, let the workers stop after their current block
+		lock_acquire(&s->lock);
+		b->done = false;
+		++p->written;
+		if (e)
+			p->blocks = p->next;
+		lock_wake(&s->lock);
+		lock_release(&s->lock);
+		if (e)
+			break;
+	}
+
+	uintptr_t const n = solver_wait_workers(s, n_workers);
+	if (!e)
+		(void)fprintf(stderr, "Sampled %zu sequences with seed %#"
+		              PRIx64 " in %.3lf ms\n", n, seed,
+		              clock_ms() - t1);
+
+close_output:
+	if (f && out) {
+		if (fclose(f) && !e) {
+			e = errno ? errno : EIO;
+			perror("fclose");
+		}
+		if (e)
+			(void)remove(out);
+	}
+
+free_sampler:
+	s->sampler = nullptr;
+	for (uint32_t i = 0U; p && i < slots; ++i)
+		free(p->slot[i].buf);
+	free(p);
+
+	return e;
+}
+
+// Words per unit of work of solver_verify(), and per call of the check
+#define VERIFY_CHUNK ((size_t)1U << 16U)
+#define VERIFY_BLOCK ((size_t)1U << 10U)
+
+/**
+ * @brief A line of a file saved with --digest.
+ */
+struct digest_line {
+	uint64_t      offset; //!< In bytes
+	uint64_t      size;   //!< In bytes
+	uint64_t      hash;
+	uint32_t      task;
+	bool          bad;    //!< Whether the file doesn't match
+};
+
+/**
+ * @brief State of solver_verify().
+ */
+struct verifier {
+	uint64_t const     *seq;
+	size_t              len;
+	size_t              size;   //!< In bytes
+	leaf_check_t       *check;
+	size_t              chunks;
+	size_t              next;   //!< Next chunk to check
+	size_t              bad;    //!< First bad word found so far, or @a len
+	bool                order;  //!< Whether @a bad is out of order
+	struct digest_line *lines;  //!< Task digests to compare with
+	size_t              n_lines;
+	size_t              line;   //!< Next task digest to compare
+};
+
+/**
+ * @brief Find the first bad word in a range.
+ *
+ * A word is bad if it isn't a De Bruijn sequence or isn't greater than
+ * the one before it. The words are checked a cache-sized block at a
+ * time, first with the vector check and then for their order.
+ *
+ * @param v     Verifier.
+ * @param i     First word.
+ * @param end   End of the range.
+ * @param order Where to store whether the bad word is out of order.
+ * @return      Index of the first bad word, or @a end if there is none.
+ */
+static size_t
+verify_range (struct verifier const *const v,
+              size_t                       i,
+              size_t const                 end,
+              bool *const                  order)
+{
+	uint64_t const *const seq = v->seq;
+
+	for (; i < end; i += VERIFY_BLOCK) {
+		size_t const n = end - i < VERIFY_BLOCK ? end - i : VERIFY_BLOCK;
+		size_t const k = i + v->check(&seq[i], n);
+
+		// Branch-free so that it vectorizes, the exact place is only
+		// looked for if there is one
+		size_t const j = i ? i : 1U;
+		bool out = false;
+		for (size_t q = j; q < i + n; ++q)
+			out |= seq[q - 1U] >= seq[q];
+
+		if (k < i + n || out) {
+			size_t o = i + n;
+			for (size_t q = j; out && q < o; ++q) {
+				if (seq[q - 1U] >= seq[q])
+					o = q;
+			}
+			*order = o < k;
+			return *order ? o : k;
+		}
+	}
+
+	return end;
+}
+
+#ifndef _WIN32
+static void *
+#else
+static unsigned __stdcall
+#endif
+verify_func (void *arg)
+{
+	struct worker *w = arg;
+	struct solver *s = container_of(w, struct solver, workers[w->id]);
+	struct verifier *const v = s->verifier;
+	unsigned count = 0U;
+
+	for (;;) {
+		// Chunks past a bad word that was already found don't matter
+		lock_acquire(&s->lock);
+		size_t id = v->next < v->chunks && v->next * VERIFY_CHUNK < v->bad
+		            ? v->next++ : SIZE_MAX;
+		lock_release(&s->lock);
+		if (id == SIZE_MAX)
+			break;
+
+		size_t const begin = id * VERIFY_CHUNK;
+		size_t const end = v->len - begin < VERIFY_CHUNK
+		                   ? v->len : begin + VERIFY_CHUNK;
+		bool order = false;
+		size_t const k = verify_range(v, begin, end, &order);
+		count += (unsigned)(k - begin);
+		if (k < end) {
+			lock_acquire(&s->lock);
+			if (k < v->bad) {
+				v->bad = k;
+				v->order = order;
+			}
+			lock_release(&s->lock);
+		}
+	}
+
+	// Then every task digest, to find all tasks that don't match
+	for (;;) {
+		lock_acquire(&s->lock);
+		size_t id = v->line < v->n_lines ? v->line++ : SIZE_MAX;
+		lock_release(&s->lock);
+		if (id == SIZE_MAX)
+			break;
+
+		struct digest_line *const l = &v->lines[id];
+		size_t const w = sizeof *v->seq;
+		l->bad = l->offset % w || l->size % w ||
+		         l->offset > v->size || l->size > v->size - l->offset ||
+		         digest_words(&v->seq[l->offset / w],
+		                      l->size / w).hash != l->hash;
+	}
+
+#ifndef _WIN32
+	return (void *)(uintptr_t)count;
+#else
+	_endthreadex(count);
+# ifdef _MSC_VER
+	return count;
+# endif // _MSC_VER
+#endif // _WIN32
+}
+
+/**
+ * @brief Read a file saved with --digest.
+ *
+ * @param path  File name.
+ * @param lines Where to store the task digests, which the caller has
+ *              to free.
+ * @param n     Where to store the number of task digests.
+ * @param size  Where to store the size of the whole output in bytes.
+ * @return      0 on success, otherwise an error code.
+ */
+static int
+digest_load (char const          *path,
+             struct digest_line **lines,
+             size_t              *n,
+             uint64_t            *size)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		int e = errno ? errno : EIO;
+		(void)fprintf(stderr, "%s: %s\n", path, strerror(e));
+		return e;
+	}
+
+	struct digest_line *l = nullptr;
+	size_t len = 0U, cap = 0U;
+	bool total = false;
+	int e = 0;
+	char buf[128];
+	while (!e && fgets(buf, sizeof buf, f)) {
+		if (buf[0] == '#' || buf[0] == '\n')
+			continue;
+		uint64_t h = 0U;
+		if (sscanf(buf, "total %" SCNu64 " %" SCNx64, size, &h) == 2) {
+			total = true;
+			continue;
+		}
+		if (len == cap) {
+			cap = cap ? cap * 2U : 256U;
+			struct digest_line *p = realloc(l, cap * sizeof *p);
+			if (!p) {
+				e = errno ? errno : ENOMEM;
+				break;
+			}
+			l = p;
+		}
+		struct digest_line *const d = &l[len++];
+		d->bad = false;
+		if (sscanf(buf, "%" SCNu32 " %*s %" SCNu64 " %" SCNu64
+		           " %" SCNx64, &d->task, &d->offset, &d->size,
+		           &d->hash) != 4)
+			e = EBADMSG;
 	}
+	if (!e && (ferror(f) || !total))
+		e = ferror(f) ? errno ? errno : EIO : EBADMSG;
+	(void)fclose(f);
 
-	return seq_count;
+	if (e) {
+		(void)fprintf(stderr, "%s: %s\n", path, strerror(e));
+		free(l);
+		return e;
+	}
+
+	*lines = l;
+	*n = len;
+	return 0;
 }
 
-static void
-solver_solve (struct solver *s,
-              char const    *out)
+/**
+ * @brief Check that a raw order-6 output file is complete and correct.
+ *
+ * The file is mapped to memory and split into chunks that the workers
+ * check in parallel. Every word has to be a De Bruijn sequence and
+ * greater than the one before it, and there have to be exactly
+ * @ref DBS26_COUNT of them. Since that is the number of order-6
+ * sequences, such a file has every one of them in ascending order.
+ *
+ * With the task digests saved by --digest, the workers also hash the
+ * output of every task and compare, which finds each task that was
+ * damaged even where the sequences would otherwise pass. The file then
+ * has to be as large as the digests say instead, so that the output of
+ * a --prefix run can be checked as well.
+ *
+ * @param s      Solver.
+ * @param path   File name.
+ * @param digest File saved with --digest, or a null pointer.
+ * @param check  Sequence check to use.
+ * @return       0 if the file is correct, EBADMSG if it isn't, otherwise
+ *               an error code.
+ */
+static int
+solver_verify (struct solver *s,
+               char const    *path,
+               char const    *digest,
+               leaf_check_t  *check)
 {
-#ifndef _WIN32
-	struct timespec t1 = {0}, t2 = {0};
-	(void)clock_gettime(CLOCK_MONOTONIC, &t1);
-#else
-	LARGE_INTEGER pf = {0}, t1 = {0}, t2 = {0};
-	QueryPerformanceFrequency(&pf);
-	QueryPerformanceCounter(&t1);
-#endif
-	uint32_t n_workers = solver_start_workers(s);
-	if (!n_workers)
-		return;
+	struct verifier v = {.check = check};
+	uint64_t size = DBS26_COUNT * sizeof *v.seq;
+	int e = digest ? digest_load(digest, &v.lines, &v.n_lines, &size) : 0;
+	if (e)
+		return e;
 
-	uintptr_t seq_count = solver_wait_workers(s, n_workers);
+	struct query q = {0};
+	e = query_map(&q, path);
+	if (e) {
+		(void)fprintf(stderr, "%s: %s\n", path, strerror(e));
+		free(v.lines);
+		return e;
+	}
 
-#ifndef _WIN32
-	(void)clock_gettime(CLOCK_MONOTONIC, &t2);
-	double ms = (double)(t2.tv_sec - t1.tv_sec) * 1000.0
-	            + (double)t2.tv_nsec / 1000000.0
-	            - (double)t1.tv_nsec / 1000000.0;
-#else
-	QueryPerformanceCounter(&t2);
-	double ms = (double)(t2.QuadPart - t1.QuadPart) * 1000.0
-	            / (double)pf.QuadPart;
-#endif
-	(void)fprintf(stderr, "Generated %zu sequences"
-	              " in %.3lf ms\n", seq_count, ms);
+	v.seq = q.map;
+	v.size = q.size;
+	v.len = q.size / sizeof *v.seq;
+	v.chunks = v.len / VERIFY_CHUNK + !!(v.len % VERIFY_CHUNK);
+	v.bad = v.len;
+	s->verifier = &v;
+
+	double const t1 = clock_ms();
+	uint32_t n_workers = solver_start_workers(s, verify_func);
+	if (!n_workers) {
+		e = EAGAIN;
+		goto unmap;
+	}
+	(void)solver_wait_workers(s, n_workers);
+	(void)fprintf(stderr, "Checked %zu sequences", v.bad);
+	if (digest)
+		(void)fprintf(stderr, " and %zu task digests", v.n_lines);
+	(void)fprintf(stderr, " in %.3lf ms\n", clock_ms() - t1);
+
+	if (v.bad < v.len) {
+		e = EBADMSG;
+		(void)fprintf(stderr, "%s: sequence %zu at byte offset %zu,"
+		              " %016" PRIx64 ", %s\n", path, v.bad,
+		              v.bad * sizeof *v.seq, v.seq[v.bad], v.order
+		              ? "isn't greater than the one before it"
+		              : "has a repeated window");
+	}
+	for (size_t i = 0U; i < v.n_lines; ++i) {
+		struct digest_line const *const l = &v.lines[i];
+		if (!l->bad)
+			continue;
+		e = EBADMSG;
+		(void)fprintf(stderr, "%s: task %" PRIu32 ", %" PRIu64 " bytes"
+		              " at byte offset %" PRIu64 ", doesn't match its"
+		              " digest\n", path, l->task, l->size, l->offset);
+	}
+	if (q.size % sizeof *v.seq) {
+		e = EBADMSG;
+		(void)fprintf(stderr, "%s: size isn't a multiple of %zu bytes\n",
+		              path, sizeof *v.seq);
+	} else if (q.size != size) {
+		e = EBADMSG;
+		(void)fprintf(stderr, "%s: %zu sequences instead of %" PRIu64
+		              "\n", path, v.len, size / sizeof *v.seq);
+	}
+	if (!e)
+		(void)fprintf(stderr, "%s: all sequences are correct\n", path);
+
+unmap:
+	s->verifier = nullptr;
+	query_unmap(&q);
+	free(v.lines);
+	return e;
+}
+
+/**
+ * @brief Check a file with solver_verify().
+ *
+ * @param path    File name.
+ * @param digest  File saved with --digest, or a null pointer.
+ * @param threads Number of threads, 0 for all CPUs.
+ * @param kernel  Check kernel. The default picks the widest vectors the
+ *                CPU has.
+ * @return        0 if the file is correct, otherwise an error code.
+ */
+static int
+verify (char const *path,
+        char const *digest,
+        uint32_t    threads,
+        enum kernel kernel)
+{
+	enum leaf_kernel k = kernel_leaf[kernel];
+	if (kernel == KERNEL_AUTO)
+		k = leaf_supported(LEAF_AVX512) ? LEAF_AVX512
+		  : leaf_supported(LEAF_AVX2) ? LEAF_AVX2 : LEAF_LOOP;
+	leaf_check_t *const check = leaf_check_get(k);
+	if (!check) {
+		(void)fprintf(stderr, "The CPU doesn't support this kernel\n");
+		return ENOTSUP;
+	}
+
+	int e = 0;
+	struct solver_cfg const cfg = {
+		.threads = threads,
+		.engine  = ENGINE_RECURSIVE,
+		.order   = SUB_LEN,
+		.kernel  = kernel,
+	};
+	struct solver *s = solver_create(&cfg, &e);
+	if (!s) {
+		(void)fprintf(stderr, "solver_create: %s\n", strerror(e));
+		return e;
+	}
+
+	e = solver_verify(s, path, digest, check);
+	solver_destroy(&s);
+	return e;
+}
+
+/**
+ * @brief Decode a file written with --format packed.
+ *
+ * @param in     Packed file.
+ * @param out    Output file, or a null pointer to only benchmark.
+ * @param range  Index of the first sequence to decode and one past the
+ *               last one, which is clamped to the end of the file.
+ * @param kernel Leaf kernel to complete the sequences with.
+ * @return       0 on success, otherwise an error code.
+ */
+static int
+unpack (char const     *in,
+        char const     *out,
+        uint64_t const *range,
+        enum kernel     kernel)
+{
+	enum leaf_kernel const k = kernel_leaf[kernel];
+	if (!leaf_supported(k)) {
+		(void)fprintf(stderr, "The CPU doesn't support this kernel\n");
+		return ENOTSUP;
+	}
+
+	struct pack_file r;
+	int e = pack_open(&r, in, leaf_get(k));
+	if (e) {
+		(void)fprintf(stderr, "%s: %s\n", in, strerror(e));
+		return e;
+	}
+
+	uint64_t const count = pack_count(&r);
+	uint64_t const end = range[1] < count ? range[1] : count;
+	if (range[0] > end || (range[1] != UINT64_MAX && range[1] > count)) {
+		(void)fprintf(stderr, "%s has %" PRIu64 " sequences\n",
+		              in, count);
+		pack_close(&r);
+		return ERANGE;
+	}
 
 	FILE *f = nullptr;
+	if (out) {
+		f = output_open(out);
+		if (!f) {
+			e = errno ? errno : EIO;
+			pack_close(&r);
+			return e;
+		}
+		if (f == stdout)
+			out = nullptr;
+	}
 
-	if (out && seq_count == 67108864U) {
+	size_t const max = (size_t)1U << 16U;
+	uint64_t *buf = malloc(max * sizeof *buf);
+	if (!buf) {
+		e = errno ? errno : ENOMEM;
+		perror("malloc");
+	}
+
+	double const t1 = clock_ms();
+	for (uint64_t i = range[0]; !e && i < end; ) {
+		size_t n = end - i < max ? (size_t)(end - i) : max;
+		e = pack_read(&r, buf, i, n);
+		if (e) {
+			(void)fprintf(stderr, "pack_read: %s\n", strerror(e));
+		} else if (f && fwrite(buf, sizeof *buf, n, f) != n) {
+			e = errno ? errno : EIO;
+			perror("fwrite");
+		}
+		i += n;
+	}
+	if (!e)
+		(void)fprintf(stderr, "Unpacked %" PRIu64 " sequences"
+		              " in %.3lf ms\n", end - range[0],
+		              clock_ms() - t1);
+
+	free(buf);
+	pack_close(&r);
+	if (f && out) {
+		if (fclose(f) && !e) {
+			e = errno ? errno : EIO;
+			perror("fclose");
+		}
+		if (e)
+			(void)remove(out);
+	}
+
+	return e;
+}
+
+/**
+ * @brief Parse a line of query input.
+ *
+ * @param v   Where to store the value or index.
+ * @param sel Where to store whether the line asks for an index.
+ * @return    0 on success, otherwise an error code.
+ */
+static int
+lookup_parse (uint64_t *const v,
+              bool *const     sel,
+              char const     *src)
+{
+	while (*src == ' ' || *src == '\t')
+		++src;
+
+	*sel = *src == '#';
+	if (*sel)
+		++src;
+	if (!((*src >= '0' && *src <= '9') ||
+	      (!*sel && (*src | 0x20) >= 'a' && (*src | 0x20) <= 'f')))
+		return EINVAL;
+
+	errno = 0;
+	char *end = nullptr;
+	*v = _Generic(*v
+		, unsigned long: strtoul
+		, unsigned long long: strtoull
+	)(src, &end, *sel ? 10 : 16);
+	if (errno)
+		return errno;
+
+	while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n')
+		++end;
+
+	return *end ? EINVAL : 0;
+}
+
+/**
+ * @brief Answer queries about an output file, see --query.
+ *
+ * @param in     Raw or packed order 6 file.
+ * @param out    Output file, or a null pointer to only benchmark.
+ * @param range  Sequences to print instead of reading queries, or
+ *               0 and UINT64_MAX for none.
+ * @param kernel Leaf kernel to decode a packed file with.
+ * @return       0 on success, otherwise an error code.
+ */
+static int
+lookup (char const     *in,
+        char const     *out,
+        uint64_t const *range,
+        enum kernel     kernel)
+{
+	enum leaf_kernel const k = kernel_leaf[kernel];
+	if (!leaf_supported(k)) {
+		(void)fprintf(stderr, "The CPU doesn't support this kernel\n");
+		return ENOTSUP;
+	}
+
+	double const t0 = clock_ms();
+	struct query q;
+	int e = query_open(&q, in, leaf_get(k));
+	if (e) {
+		(void)fprintf(stderr, "%s: %s\n", in, strerror(e));
+		return e;
+	}
+	(void)fprintf(stderr, "Indexed %zu sequences in %.3lf ms\n",
+	              q.len, clock_ms() - t0);
+
+	bool const select = range[0] || range[1] != UINT64_MAX;
+	uint64_t const end = range[1] < q.len ? range[1] : q.len;
+	if (select && (range[0] > end || (range[1] != UINT64_MAX &&
+	                                  range[1] > q.len))) {
+		(void)fprintf(stderr, "%s has %zu sequences\n", in, q.len);
+		query_close(&q);
+		return ERANGE;
+	}
+
+	FILE *f = nullptr;
+	if (out) {
 		if (out[0] == '-' && !out[1]) {
 			f = stdout;
 			out = nullptr;
-#ifdef _WIN32
-			(void)fflush(stdout);
-			(void)_setmode(_fileno(stdout), _O_BINARY);
-#endif
-		} else {
-#ifndef _WIN32
-			f = fopen(out, "wbe");
-			if (!f &&
-			    (errno != EINVAL || !(f = fopen(out, "wb"))))
-#else
-			f = fopen(out, "wb");
-			if (!f)
-#endif
-				perror("fopen");
-			else
-				(void)fprintf(stderr, "Saving to %s\n", out);
+		} else if (!(f = fopen(out, "w"))) {
+			e = errno ? errno : EIO;
+			perror("fopen");
+			query_close(&q);
+			return e;
 		}
 	}
 
-	for (size_t i = 0U; i < countof(s->tasks); ++i) {
-		size_t len = u64_view_len(s->tasks[i]);
-		if (len && f) {
-			uint64_t const *ptr = s->tasks[i].begin[0];
-			if (fwrite(ptr, sizeof *ptr, len, f) != len) {
-				if (out) {
-					perror("fwrite");
-					(void)fclose(f);
+	double const t1 = clock_ms();
+	uint64_t count = 0U;
+	if (select) {
+		for (uint64_t i = range[0]; f && i < end; ++i) {
+			if (fprintf(f, "%016" PRIx64 "\n", q.seq[i]) < 0) {
+				e = errno ? errno : EIO;
+				break;
+			}
+		}
+		count = end - range[0];
+	} else {
+		enum { max = 4096 };
+		uint64_t v[max], key[max], idx[max];
+		bool sel[max];
+		char line[256];
+		size_t n = 0U;
+		uint64_t no = 0U;
+		int bad = 0;
+
+		// A bad line ends the input, but the lines before it are
+		// still answered
+		for (bool more = true; !e && more; ) {
+			more = fgets(line, sizeof line, stdin) != nullptr;
+			if (more) {
+				++no;
+				size_t const len = strlen(line);
+				if (len && line[len - 1U] != '\n' &&
+				    !feof(stdin)) {
+					bad = EINVAL;
+					(void)fprintf(stderr, "stdin:%" PRIu64
+					              ": line is too long\n", no);
+				} else if ((bad = lookup_parse(&v[n], &sel[n],
+				                               line))) {
+					(void)fprintf(stderr, "stdin:%" PRIu64
+					              ": %s\n", no, strerror(bad));
+				} else if (++n < max) {
+					continue;
 				}
-				f = nullptr;
+				more = !bad;
+			}
+
+			// Selects only need the index, so leave them out
+			size_t m = 0U;
+			for (size_t i = 0U; i < n; ++i)
+				if (!sel[i])
+					key[m++] = v[i];
+			query_find(&q, key, idx, m);
+
+			for (size_t i = 0U, j = 0U; f && !e && i < n; ++i) {
+				int r;
+				if (sel[i])
+					r = v[i] < q.len
+					    ? fprintf(f, "%016" PRIx64 "\n",
+					              q.seq[v[i]])
+					    : fputs("-\n", f);
+				else if (idx[j++] == UINT64_MAX)
+					r = fputs("-\n", f);
+				else
+					r = fprintf(f, "%" PRIu64 "\n",
+					            idx[j - 1U]);
+				if (r < 0)
+					e = errno ? errno : EIO;
 			}
+			count += n;
+			n = 0U;
 		}
+		if (!e && ferror(stdin))
+			e = errno ? errno : EIO;
+		if (!e)
+			e = bad;
 	}
 
-	if (f && out)
-		(void)fclose(f);
+	if (!e)
+		(void)fprintf(stderr, "Answered %" PRIu64 " queries"
+		              " in %.3lf ms\n", count, clock_ms() - t1);
+	else if (e != EINVAL)
+		(void)fprintf(stderr, "lookup: %s\n", strerror(e));
+
+	query_close(&q);
+	if (f && out && fclose(f) && !e) {
+		e = errno ? errno : EIO;
+		perror("fclose");
+	}
+
+	return e;
+}
+
+/**
+ * @brief Statistics of repeated benchmark runs.
+ */
+struct bench {
+	uint32_t threads;
+	uint64_t count;   //!< Sequences per run
+	double  *ms;      //!< Times of the runs, warmup first
+	double   min;
+	double   median;
+	double   mean;
+	double   stddev;
+	double   p95;
+	double   rate;    //!< Sequences per second at the median time
+};
+
+static int
+bench_cmp (void const *a,
+           void const *b)
+{
+	double const x = *(double const *)a, y = *(double const *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Get a square root without linking the math library.
+ */
+static double
+bench_sqrt (double const x)
+{
+	double r = x > 1.0 ? x : 1.0;
+	for (uint32_t i = 0U; x > 0.0 && i < 64U; ++i) {
+		double const q = (r + x / r) * 0.5;
+		if (q >= r)
+			break;
+		r = q;
+	}
+	return x > 0.0 ? r : 0.0;
+}
+
+/**
+ * @brief Compute the statistics of the timed runs of @a b.
+ */
+static void
+bench_stats (struct bench *const b,
+             uint32_t const      n)
+{
+	double *const t = malloc(n * sizeof *t);
+	double const *const v = t ? t : &b->ms[1];
+	double sum = 0.0, sq = 0.0;
+
+	if (t) {
+		(void)memcpy(t, &b->ms[1], n * sizeof *t);
+		qsort(t, n, sizeof *t, bench_cmp);
+	}
+	for (uint32_t i = 0U; i < n; ++i)
+		sum += v[i];
+	b->mean = sum / n;
+	for (uint32_t i = 0U; i < n; ++i)
+		sq += (v[i] - b->mean) * (v[i] - b->mean);
+
+	// The percentile is the nearest rank one
+	b->stddev = n > 1U ? bench_sqrt(sq / (n - 1U)) : 0.0;
+	b->min = v[0];
+	b->median = n % 2U ? v[n / 2U] : (v[n / 2U - 1U] + v[n / 2U]) * 0.5;
+	b->p95 = v[(n * 95U + 99U) / 100U - 1U];
+	b->rate = b->median > 0.0 ? (double)b->count * 1000.0 / b->median
+	                          : 0.0;
+	free(t);
+}
+
+/**
+ * @brief Run a benchmark with one thread count.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+bench_run (struct solver_cfg const *const cfg,
+           uint32_t const                 repeat,
+           struct bench *const            b)
+{
+	int e = 0;
+	struct solver *s = solver_create(cfg, &e);
+	if (!s) {
+		(void)fprintf(stderr, "solver_create: %s\n", strerror(e));
+		return e;
+	}
+
+	b->threads = s->n_workers;
+	for (uint32_t i = 0U; !e && i <= repeat; ++i) {
+		uintptr_t n = 0U;
+		double const t1 = clock_ms();
+		e = solver_run(s, nullptr, &n);
+		b->ms[i] = clock_ms() - t1;
+		b->count = n;
+		if (e)
+			(void)fprintf(stderr, "solver_run: %s\n", strerror(e));
+		else if (!i)
+			(void)fprintf(stderr, "Warmup run: %.3lf ms\n", b->ms[i]);
+		else
+			(void)fprintf(stderr, "Run %" PRIu32 ": %.3lf ms\n",
+			              i, b->ms[i]);
+	}
+
+	solver_destroy(&s);
+	if (!e)
+		bench_stats(b, repeat);
+	return e;
+}
+
+/**
+ * @brief Write benchmark results as JSON.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+bench_json (char const         *path,
+            struct args const  *a,
+            struct bench const *b,
+            uint32_t            n,
+            uint32_t            repeat)
+{
+	bool const out = !(path[0] == '-' && !path[1]);
+	FILE *f = out ? fopen(path, "w") : stdout;
+	if (!f) {
+		int e = errno ? errno : EIO;
+		perror("fopen");
+		return e;
+	}
+
+	(void)fprintf(f, "{\n  \"order\": %" PRIu32 ",\n  \"prefix_bits\": %"
+	              PRIu32 ",\n  \"repeat\": %" PRIu32 ",\n  \"results\": [",
+	              a->order, a->prefix_len, repeat);
+	for (uint32_t i = 0U; i < n; ++i) {
+		(void)fprintf(f, "%s\n    {\n      \"threads\": %" PRIu32
+		              ",\n      \"sequences\": %" PRIu64
+		              ",\n      \"warmup_ms\": %.3lf,\n      \"ms\": [",
+		              i ? "," : "", b[i].threads, b[i].count, b[i].ms[0]);
+		for (uint32_t j = 1U; j <= repeat; ++j)
+			(void)fprintf(f, "%s%.3lf", j > 1U ? ", " : "", b[i].ms[j]);
+		(void)fprintf(f, "],\n      \"min_ms\": %.3lf"
+		              ",\n      \"median_ms\": %.3lf"
+		              ",\n      \"mean_ms\": %.3lf"
+		              ",\n      \"stddev_ms\": %.3lf"
+		              ",\n      \"p95_ms\": %.3lf"
+		              ",\n      \"sequences_per_s\": %.1lf"
+		              ",\n      \"sequences_per_s_per_thread\": %.1lf"
+		              ",\n      \"speedup\": %.3lf\n    }",
+		              b[i].min, b[i].median, b[i].mean, b[i].stddev,
+		              b[i].p95, b[i].rate, b[i].rate / b[i].threads,
+		              b[0].rate > 0.0 ? b[i].rate / b[0].rate : 0.0);
+	}
+	(void)fprintf(f, "\n  ]\n}\n");
+
+	int e = ferror(f) ? errno ? errno : EIO : 0;
+	if (out && fclose(f) && !e)
+		e = errno ? errno : EIO;
+	if (e)
+		(void)fprintf(stderr, "%s: %s\n", path, strerror(e));
+	return e;
+}
+
+/**
+ * @brief Benchmark the search with repeated runs.
+ *
+ * Each thread count of the --threads list gets a solver of its own,
+ * which makes a warmup run followed by the timed ones. Nothing is
+ * written out, but the sequences are generated into memory as with
+ * --benchmark unless --sink says otherwise.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+bench (struct args const *const a)
+{
+	uint32_t const n = a->sweep_len ? a->sweep_len : 1U;
+	uint32_t const repeat = a->repeat ? a->repeat : 1U;
+	struct bench *b = calloc(n, sizeof *b);
+	double *ms = calloc((size_t)n * (repeat + 1U), sizeof *ms);
+	int e = b && ms ? 0 : errno ? errno : ENOMEM;
+	if (e)
+		perror("calloc");
+
+	for (uint32_t i = 0U; !e && i < n; ++i) {
+		struct solver_cfg const cfg = {
+			.threads    = a->sweep_len ? a->sweep[i] : a->threads,
+			.mem_limit  = (uint64_t)a->memory << 20U,
+			.engine     = a->engine,
+			.order      = a->order,
+			.prefix_len = a->prefix_len,
+			.prefix     = a->prefix,
+			.split      = a->split_depth,
+			.kernel     = a->kernel,
+			.sym        = a->symmetry,
+			.format     = a->format,
+			.sink       = a->sink,
+			.verbose    = !i,
+		};
+		b[i].ms = &ms[(size_t)i * (repeat + 1U)];
+		e = bench_run(&cfg, repeat, &b[i]);
+		if (e)
+			break;
+
+		(void)fprintf(stderr, "%" PRIu32 " threads, %" PRIu32 " runs:"
+		              " min %.3lf ms, median %.3lf ms, mean %.3lf ms,"
+		              " stddev %.3lf ms, p95 %.3lf ms\n%" PRIu64
+		              " sequences at %.0lf per second, %.0lf per"
+		              " thread\n", b[i].threads, repeat, b[i].min,
+		              b[i].median, b[i].mean, b[i].stddev, b[i].p95,
+		              b[i].count, b[i].rate, b[i].rate / b[i].threads);
+	}
+
+	if (!e && n > 1U) {
+		(void)fprintf(stderr, "\nThreads   Median ms  Sequences/s"
+		              "  Speedup  Efficiency\n");
+		for (uint32_t i = 0U; i < n; ++i) {
+			double const x = b[0].rate > 0.0
+			                 ? b[i].rate / b[0].rate : 0.0;
+			(void)fprintf(stderr, "%7" PRIu32 " %11.3lf %12.0lf"
+			              " %8.2lf %10.1lf%%\n", b[i].threads,
+			              b[i].median, b[i].rate, x, x * 100.0
+			              * b[0].threads / b[i].threads);
+		}
+	}
+
+	if (!e && a->json)
+		e = bench_json(a->json, a, b, n, repeat);
+
+	free(ms);
+	free(b);
+	return e;
 }
 
 int
-main (int   argc,
-      char *argv[])
+dbs26_run (struct args const *const a)
 {
-	struct args a = args(argc, argv);
+	if (a->unpack)
+		return unpack(a->unpack, a->output, a->range, a->kernel);
 
+	if (a->query)
+		return lookup(a->query, a->output, a->range, a->kernel);
+
+	if (a->verify)
+		return verify(a->verify, a->digest, a->threads, a->kernel);
+
+	if (a->n_files)
+		return shard_merge(a->output, a->files, a->n_files);
+
+	if (a->repeat || a->sweep_len > 1U)
+		return bench(a);
+
+	// Sequences picked by index are found on this thread alone, and
+	// samples don't use the search tasks
+	bool const select = a->range[0] || a->range[1] != UINT64_MAX;
 	int e = 0;
-	struct solver *s = solver_create(a.threads, &e);
+	struct solver_cfg const cfg = {
+		.threads    = select ? 1U : a->threads,
+		.mem_limit  = (uint64_t)a->memory << 20U,
+		.engine     = a->sample ? ENGINE_GENERIC : a->engine,
+		.order      = a->order,
+		.prefix_len = a->prefix_len,
+		.prefix     = a->prefix,
+		.split      = a->split_depth,
+		.kernel     = a->kernel,
+		.sym        = a->symmetry,
+		.format     = a->format,
+		.sink       = a->sink,
+		.stats      = a->stats,
+		.perf       = a->perf,
+		.trace      = a->trace != nullptr,
+		.progress   = a->progress,
+		.status_fd  = a->status_fd,
+		.digest     = a->digest != nullptr,
+		.checkpoint = a->checkpoint,
+		.resume     = a->resume,
+		.shard      = a->shard,
+		.shards     = a->shards,
+		.verbose    = !select && !a->sample,
+	};
+	struct solver *s = solver_create(&cfg, &e);
 	if (!s) {
 		(void)fprintf(stderr, "solver_create: %s\n", strerror(e));
-		return EXIT_FAILURE;
+		return e;
 	}
 
-	solver_solve(s, a.output);
+	if (a->sample)
+		e = solver_sample(s, a->output, a->sample, a->seed);
+	else if (select)
+		e = solver_select(s, a->output, a->range);
+	else
+		e = solver_solve(s, a->output, a->mmap);
+	if (!e && a->stats)
+		e = solver_stats(s, a->stats_csv);
+	if (!e && a->perf)
+		e = solver_perf(s);
+	if (!e && a->trace)
+		e = solver_trace(s, a->trace);
+	if (!e && a->digest)
+		e = solver_digest(s, a->digest);
 	solver_destroy(&s);
 
-	return EXIT_SUCCESS;
+	return e;
+}
+
+struct dbs26 {
+	struct solver *s;
+};
+
+struct dbs26 *
+dbs26_create (uint32_t const threads,
+              int *const     err)
+{
+	struct dbs26 *g = malloc(sizeof *g);
+	if (!g) {
+		if (err)
+			*err = errno ? errno : ENOMEM;
+		return nullptr;
+	}
+
+	struct solver_cfg const cfg = {
+		.threads = threads,
+		.engine  = ENGINE_RECURSIVE,
+		.order   = SUB_LEN,
+		.kernel  = KERNEL_AUTO,
+		.format  = FORMAT_RAW,
+	};
+	g->s = solver_create(&cfg, err);
+	if (!g->s) {
+		free(g);
+		return nullptr;
+	}
+
+	return g;
+}
+
+void
+dbs26_destroy (struct dbs26 *const g)
+{
+	if (g) {
+		solver_destroy(&g->s);
+		free(g);
+	}
+}
+
+int
+dbs26_generate (struct dbs26 *const g,
+                uint64_t *const     dst,
+                size_t const        len)
+{
+	struct solver *s = g->s;
+	if (len < DBS26_COUNT || !dst)
+		return EINVAL;
+
+	uintptr_t n = 0U;
+	s->map = dst;
+	int e = solver_run(s, nullptr, &n);
+	s->map = nullptr;
+	return e;
+}
+
+int
+dbs26_stream (struct dbs26 *const     g,
+              dbs26_batch_func *const func,
+              void *const             ctx)
+{
+	struct solver *s = g->s;
+	if (!func)
+		return EINVAL;
+
+	uintptr_t n = 0U;
+	s->batch = func;
+	s->batch_ctx = ctx;
+	int e = solver_run(s, nullptr, &n);
+	s->batch = nullptr;
+	s->batch_ctx = nullptr;
+	return e;
+}
+
+/**
+ * @brief Copy a batch of sequences for dbs26_unrank().
+ */
+static int
+unrank_copy (void           *ctx,
+             uint64_t const *seq,
+             size_t          n)
+{
+	uint64_t **const dst = ctx;
+	if (n) {
+		(void)memcpy(*dst, seq, n * sizeof *seq);
+		*dst += n;
+	}
+	return 0;
+}
+
+int
+dbs26_unrank (struct dbs26 *const g,
+              uint64_t            *dst,
+              uint64_t const       first,
+              size_t const         n)
+{
+	struct solver *s = g->s;
+	if (!dst && n)
+		return EINVAL;
+
+	s->batch = unrank_copy;
+	s->batch_ctx = &dst;
+	int e = solver_unrank(s, nullptr, first, n);
+	s->batch = nullptr;
+	s->batch_ctx = nullptr;
+	return e;
+}
+
+struct dbs26_query {
+	struct query q;
+};
+
+struct dbs26_query *
+dbs26_query_open (char const *const path,
+                  int *const        err)
+{
+	int e = EINVAL;
+	struct dbs26_query *q = nullptr;
+
+	if (path) {
+		q = malloc(sizeof *q);
+		if (!q)
+			e = errno ? errno : ENOMEM;
+		else if ((e = query_open(&q->q, path,
+		                         leaf_get(kernel_leaf[KERNEL_AUTO])))) {
+			free(q);
+			q = nullptr;
+		}
+	}
+
+	if (!q && err)
+		*err = e;
+	return q;
+}
+
+void
+dbs26_query_close (struct dbs26_query *const q)
+{
+	if (q) {
+		query_close(&q->q);
+		free(q);
+	}
+}
+
+uint64_t
+dbs26_query_count (struct dbs26_query const *const q)
+{
+	return q->q.len;
+}
+
+void
+dbs26_query_rank (struct dbs26_query const *const q,
+                  uint64_t const *const           v,
+                  uint64_t *const                 rank,
+                  size_t const                    n)
+{
+	query_rank(&q->q, v, rank, n);
+}
+
+void
+dbs26_query_find (struct dbs26_query const *const q,
+                  uint64_t const *const           v,
+                  uint64_t *const                 idx,
+                  size_t const                    n)
+{
+	query_find(&q->q, v, idx, n);
+}
+
+int
+dbs26_query_select (struct dbs26_query const *const q,
+                    uint64_t *const                 dst,
+                    uint64_t const                  first,
+                    size_t const                    n)
+{
+	if (first > q->q.len || n > q->q.len - first)
+		return ERANGE;
+	if (n)
+		(void)memcpy(dst, &q->q.seq[first], n * sizeof *dst);
+	return 0;
 }
@@ -0,0 +1,200 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file dbs26.h
+ * @brief libdbs26 public interface
+ * @author Juuso Alasuutari
+ *
+ * Generates all 67108864 binary De Bruijn sequences with subsequence
+ * length 6 in ascending order, in the same form as the dbs26 program
+ * outputs them, and answers queries about the generated set. Link
+ * with libdbs26.a or libdbs26.so, and with pthreads where that is
+ * separate from the C library.
+ */
+#ifndef DBS26_SRC_DBS26_H_
+#define DBS26_SRC_DBS26_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined __GNUC__ && !defined _WIN32
+# define DBS26_API __attribute__((visibility("default")))
+#else
+# define DBS26_API
+#endif
+
+/** @brief Number of sequences in the complete set. */
+#define DBS26_COUNT UINT64_C(67108864)
+
+/** @brief A generator. */
+struct dbs26;
+
+/**
+ * @brief Receive a batch of sequences from dbs26_stream().
+ *
+ * The batches arrive in order, in the thread that called dbs26_stream(),
+ * while later ones are still being generated. The sequences are only
+ * valid until the callback returns.
+ *
+ * @param ctx The pointer passed to dbs26_stream().
+ * @param seq Sequences.
+ * @param n   Number of sequences.
+ * @return    0 to continue, or an error code to stop generating. The
+ *            error code is then returned from dbs26_stream().
+ */
+typedef int dbs26_batch_func(void           *ctx,
+                             uint64_t const *seq,
+                             size_t          n);
+
+/**
+ * @brief Create a generator.
+ *
+ * @param threads Number of threads to generate with, 0 for one per
+ *                available logical CPU.
+ * @param err     Where to store an error code on failure. Optional.
+ * @return        A generator, or a null pointer on failure.
+ */
+DBS26_API extern struct dbs26 *
+dbs26_create (uint32_t threads,
+              int     *err);
+
+/**
+ * @brief Destroy a generator. Does nothing if @a g is a null pointer.
+ */
+DBS26_API extern void
+dbs26_destroy (struct dbs26 *g);
+
+/**
+ * @brief Generate all sequences into an array.
+ *
+ * The threads write their results straight into place.
+ *
+ * @param g   Generator.
+ * @param dst Array for @ref DBS26_COUNT sequences.
+ * @param len Length of @a dst.
+ * @return    0 on success, otherwise an error code.
+ */
+DBS26_API extern int
+dbs26_generate (struct dbs26 *g,
+                uint64_t     *dst,
+                size_t        len);
+
+/**
+ * @brief Generate all sequences and pass them to a callback in batches.
+ *
+ * @param g    Generator.
+ * @param func Callback.
+ * @param ctx  Passed on to @a func as is.
+ * @return     0 on success, otherwise an error code.
+ */
+DBS26_API extern int
+dbs26_stream (struct dbs26     *g,
+              dbs26_batch_func *func,
+              void             *ctx);
+
+/**
+ * @brief Generate sequences by their index in the complete set.
+ *
+ * Finds sequence @a first by counting its way down the search tree,
+ * without generating the ones before it, and then generates the rest
+ * in order. This is done on the calling thread and takes a fraction
+ * of a second for the first sequence, so it's meant for picking out
+ * a few sequences rather than most of them. The subtree sizes counted
+ * on the way are cached in @a g for later calls.
+ *
+ * @param g     Generator.
+ * @param dst   Output array.
+ * @param first Index of the first sequence.
+ * @param n     Number of sequences.
+ * @return      0 on success, ERANGE if the range is out of bounds,
+ *              otherwise an error code.
+ */
+DBS26_API extern int
+dbs26_unrank (struct dbs26 *g,
+              uint64_t     *dst,
+              uint64_t      first,
+              size_t        n);
+
+/** @brief An output file opened for queries. */
+struct dbs26_query;
+
+/**
+ * @brief Open an output file for queries.
+ *
+ * The file is either raw, as written by dbs26_generate() or the dbs26
+ * program, or in the packed format of the program. A raw file is
+ * mapped into memory and a packed one is decoded into it. The
+ * sequences must be in strictly ascending order.
+ *
+ * @param path File name.
+ * @param err  Where to store an error code on failure. Optional.
+ * @return     The opened file, or a null pointer on failure.
+ */
+DBS26_API extern struct dbs26_query *
+dbs26_query_open (char const *path,
+                  int        *err);
+
+/**
+ * @brief Close a file opened with dbs26_query_open(). Does nothing if
+ *        @a q is a null pointer.
+ */
+DBS26_API extern void
+dbs26_query_close (struct dbs26_query *q);
+
+/**
+ * @brief Get the number of sequences in an opened file.
+ */
+DBS26_API extern uint64_t
+dbs26_query_count (struct dbs26_query const *q);
+
+/**
+ * @brief Count the sequences less than each of a batch of values.
+ *
+ * Lookups are overlapped with each other, so large batches are much
+ * faster than one value at a time.
+ *
+ * @param q    Opened file.
+ * @param v    Values.
+ * @param rank Output array for the counts.
+ * @param n    Number of values.
+ */
+DBS26_API extern void
+dbs26_query_rank (struct dbs26_query const *q,
+                  uint64_t const           *v,
+                  uint64_t                 *rank,
+                  size_t                    n);
+
+/**
+ * @brief Find the index of each of a batch of values.
+ *
+ * Like dbs26_query_rank(), but stores UINT64_MAX for every value that
+ * isn't one of the sequences.
+ */
+DBS26_API extern void
+dbs26_query_find (struct dbs26_query const *q,
+                  uint64_t const           *v,
+                  uint64_t                 *idx,
+                  size_t                    n);
+
+/**
+ * @brief Get a range of sequences by index.
+ *
+ * @param q     Opened file.
+ * @param dst   Output array.
+ * @param first Index of the first sequence.
+ * @param n     Number of sequences.
+ * @return      0 on success, ERANGE if the range is out of bounds.
+ */
+DBS26_API extern int
+dbs26_query_select (struct dbs26_query const *q,
+                    uint64_t                 *dst,
+                    uint64_t                  first,
+                    size_t                    n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DBS26_SRC_DBS26_H_ */
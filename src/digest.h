@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file digest.h
+ * @brief Mergeable 64-bit hash of the output for --digest
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_DIGEST_H_
+#define DBS26_SRC_DIGEST_H_
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The digest of words w[0] ... w[n-1] is the polynomial
+ *
+ *   mix(w[0]) * P^(n-1) + mix(w[1]) * P^(n-2) + ... + mix(w[n-1])
+ *
+ * modulo 2^64, where mix() is the final avalanche step of XXH3. Unlike
+ * a streaming hash, the digest of two ranges one after the other can be
+ * computed from the digests and lengths of the two alone, so workers
+ * can hash the pieces of a task as they finish them, in any order and
+ * however the task happens to be split, and the result is the same as
+ * hashing the whole output at once.
+ *
+ * mix() is a bijection and P is odd, so changing any single word always
+ * changes the digest.
+ */
+
+#define DIGEST_PRIME UINT64_C(0x9e3779b185ebca87)
+
+// Words hashed in parallel, which the compiler turns into vectors
+#define DIGEST_LANES 8U
+
+/**
+ * @brief Digest of a range of words.
+ */
+struct digest {
+	uint64_t hash;
+	uint64_t len;  //!< Number of words
+};
+
+static const_inline uint64_t
+digest_mix (uint64_t x)
+{
+	x ^= x >> 37U;
+	x *= UINT64_C(0x165667919e3779f9);
+	return x ^ (x >> 32U);
+}
+
+/**
+ * @brief Get @ref DIGEST_PRIME to the power of @a n.
+ */
+static const_inline uint64_t
+digest_pow (uint64_t n)
+{
+	uint64_t r = 1U, p = DIGEST_PRIME;
+	for (; n; n >>= 1U, p *= p) {
+		if (n & 1U)
+			r *= p;
+	}
+	return r;
+}
+
+/**
+ * @brief Get the digest of @a a followed by @a b.
+ */
+static const_inline struct digest
+digest_cat (struct digest const a,
+            struct digest const b)
+{
+	return (struct digest){
+		.hash = a.hash * digest_pow(b.len) + b.hash,
+		.len  = a.len + b.len,
+	};
+}
+
+/**
+ * @brief Hash @a n words.
+ *
+ * Every lane hashes every @ref DIGEST_LANES th word, and the lanes are
+ * then combined as if they had been hashed one word at a time.
+ */
+static inline struct digest
+digest_words (uint64_t const *const w,
+              size_t const          n)
+{
+	uint64_t acc[DIGEST_LANES] = {0};
+	uint64_t const step = digest_pow(DIGEST_LANES);
+	size_t const m = n - n % DIGEST_LANES;
+
+	for (size_t i = 0U; i < m; i += DIGEST_LANES) {
+		for (uint32_t j = 0U; j < DIGEST_LANES; ++j)
+			acc[j] = acc[j] * step + digest_mix(w[i + j]);
+	}
+
+	uint64_t h = 0U;
+	for (uint32_t j = 0U; j < DIGEST_LANES; ++j)
+		h = h * DIGEST_PRIME + acc[j];
+	for (size_t i = m; i < n; ++i)
+		h = h * DIGEST_PRIME + digest_mix(w[i]);
+
+	return (struct digest){.hash = h, .len = n};
+}
+
+#endif /* DBS26_SRC_DIGEST_H_ */
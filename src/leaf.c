@@ -0,0 +1,285 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file leaf.c
+ * @brief Vectorized last-level search kernels
+ * @author Juuso Alasuutari
+ */
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bits.h"
+#include "leaf.h"
+#include "window.h"
+
+#if defined __x86_64__ || defined _M_X64
+# define LEAF_X86
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>
+#  define leaf_target(...)
+# else
+#  define leaf_target(...) __attribute__((target(__VA_ARGS__)))
+# endif
+#endif
+
+/*
+ * The sequence checks build the one-hot masks of all 64 windows the
+ * same way, 59 from the word itself and 5 from it rotated left by 5
+ * bits. The vector ones load several words at a time and only stop to
+ * find the bad word once a vector has one.
+ */
+
+static size_t
+leaf_check_loop (uint64_t const *const seq,
+                 size_t const          n)
+{
+	for (size_t i = 0U; i < n; ++i) {
+		uint64_t const c = seq[i];
+		uint64_t const r = c << 5U | c >> 59U;
+		if ((window_bits(c, 59U) | window_bits(r, 5U)) != UINT64_MAX)
+			return i;
+	}
+	return n;
+}
+
+#ifdef LEAF_X86
+
+/*
+ * Each lane holds one candidate. The 11 windows of every lane are
+ * turned into one-hot masks with variable shifts and ORed together
+ * with the parent's window map, so a lane is a complete sequence if
+ * and only if the result has every bit set. There are no branches per
+ * candidate, only per survivor, and there are few of those.
+ */
+
+leaf_target("avx2") static uint32_t
+leaf_avx2 (uint64_t *const dst,
+           uint64_t        seq,
+           uint64_t const  end,
+           uint64_t const  map)
+{
+	__m256i const one = _mm256_set1_epi64x(1);
+	__m256i const low = _mm256_set1_epi64x(63);
+	__m256i const all = _mm256_set1_epi64x(-1);
+	__m256i const inc = _mm256_set1_epi64x(4);
+	__m256i const m = _mm256_set1_epi64x((long long)map);
+	__m256i c = _mm256_add_epi64(_mm256_set1_epi64x((long long)seq),
+	                             _mm256_setr_epi64x(0, 1, 2, 3));
+	uint32_t n = 0U;
+
+	for (;; seq += 4U, c = _mm256_add_epi64(c, inc)) {
+		__m256i r = _mm256_or_si256(_mm256_slli_epi64(c, 5),
+		                            _mm256_srli_epi64(c, 59));
+		__m256i v = m;
+		for (int i = 0; i < 6; ++i)
+			v = _mm256_or_si256(v, _mm256_sllv_epi64(one,
+				_mm256_and_si256(_mm256_srli_epi64(c, i), low)));
+		for (int i = 0; i < 5; ++i)
+			v = _mm256_or_si256(v, _mm256_sllv_epi64(one,
+				_mm256_and_si256(_mm256_srli_epi64(r, i), low)));
+
+		uint32_t k = (uint32_t)_mm256_movemask_pd(
+			_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, all)));
+		if (end - seq < 3U)
+			k &= (2U << (end - seq)) - 1U;
+
+		for (; k; k &= k - 1U) {
+			uint64_t q = seq + count_lsb_1(~k);
+			dst[n++] = q << 1U | q >> 63U;
+		}
+
+		if (end - seq < 4U)
+			return n;
+	}
+}
+
+leaf_target("avx512f,popcnt") static uint32_t
+leaf_avx512 (uint64_t *const dst,
+             uint64_t        seq,
+             uint64_t const  end,
+             uint64_t const  map)
+{
+	__m512i const one = _mm512_set1_epi64(1);
+	__m512i const low = _mm512_set1_epi64(63);
+	__m512i const all = _mm512_set1_epi64(-1);
+	__m512i const inc = _mm512_set1_epi64(8);
+	__m512i const m = _mm512_set1_epi64((long long)map);
+	__m512i c = _mm512_add_epi64(_mm512_set1_epi64((long long)seq),
+	                             _mm512_setr_epi64(0, 1, 2, 3,
+	                                               4, 5, 6, 7));
+	uint32_t n = 0U;
+
+	for (;; seq += 8U, c = _mm512_add_epi64(c, inc)) {
+		__m512i r = _mm512_rol_epi64(c, 5);
+		__m512i v = m;
+		for (int i = 0; i < 6; ++i)
+			v = _mm512_or_si512(v, _mm512_sllv_epi64(one,
+				_mm512_and_si512(_mm512_srli_epi64(c, i), low)));
+		for (int i = 0; i < 5; ++i)
+			v = _mm512_or_si512(v, _mm512_sllv_epi64(one,
+				_mm512_and_si512(_mm512_srli_epi64(r, i), low)));
+
+		__mmask8 k = _mm512_cmpeq_epi64_mask(v, all);
+		if (end - seq < 7U)
+			k &= (__mmask8)((2U << (end - seq)) - 1U);
+
+		_mm512_mask_compressstoreu_epi64(&dst[n], k,
+		                                 _mm512_rol_epi64(c, 1));
+		n += (uint32_t)_mm_popcnt_u32(k);
+
+		if (end - seq < 8U)
+			return n;
+	}
+}
+
+leaf_target("avx2") static size_t
+leaf_check_avx2 (uint64_t const *const seq,
+                 size_t const          n)
+{
+	__m256i const one = _mm256_set1_epi64x(1);
+	__m256i const low = _mm256_set1_epi64x(63);
+	__m256i const all = _mm256_set1_epi64x(-1);
+	size_t i = 0U;
+
+	for (; n - i >= 4U; i += 4U) {
+		__m256i const c = _mm256_loadu_si256((__m256i const *)&seq[i]);
+		__m256i const r = _mm256_or_si256(_mm256_slli_epi64(c, 5),
+		                                  _mm256_srli_epi64(c, 59));
+		__m256i v = _mm256_setzero_si256();
+		for (int j = 0; j < 59; ++j)
+			v = _mm256_or_si256(v, _mm256_sllv_epi64(one,
+				_mm256_and_si256(_mm256_srli_epi64(c, j), low)));
+		for (int j = 0; j < 5; ++j)
+			v = _mm256_or_si256(v, _mm256_sllv_epi64(one,
+				_mm256_and_si256(_mm256_srli_epi64(r, j), low)));
+
+		uint32_t const k = (uint32_t)_mm256_movemask_pd(
+			_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, all)));
+		if (k != 0xfU)
+			return i + count_lsb_1(k);
+	}
+
+	return i + leaf_check_loop(&seq[i], n - i);
+}
+
+leaf_target("avx512f") static size_t
+leaf_check_avx512 (uint64_t const *const seq,
+                   size_t const          n)
+{
+	__m512i const one = _mm512_set1_epi64(1);
+	__m512i const low = _mm512_set1_epi64(63);
+	__m512i const all = _mm512_set1_epi64(-1);
+	size_t i = 0U;
+
+	for (; n - i >= 8U; i += 8U) {
+		__m512i const c = _mm512_loadu_si512(&seq[i]);
+		__m512i const r = _mm512_rol_epi64(c, 5);
+		__m512i v = _mm512_setzero_si512();
+		for (int j = 0; j < 59; ++j)
+			v = _mm512_or_si512(v, _mm512_sllv_epi64(one,
+				_mm512_and_si512(_mm512_srli_epi64(c, j), low)));
+		for (int j = 0; j < 5; ++j)
+			v = _mm512_or_si512(v, _mm512_sllv_epi64(one,
+				_mm512_and_si512(_mm512_srli_epi64(r, j), low)));
+
+		uint32_t const k = _mm512_cmpeq_epi64_mask(v, all);
+		if (k != 0xffU)
+			return i + count_lsb_1(k);
+	}
+
+	return i + leaf_check_loop(&seq[i], n - i);
+}
+
+/**
+ * @brief Check for CPU and OS support of AVX2 and AVX-512F.
+ *
+ * @return 2 for AVX-512F, 1 for AVX2, 0 for neither.
+ */
+static int
+leaf_cpuid (void)
+{
+#ifdef _MSC_VER
+	int r[4];
+	__cpuid(r, 0);
+	if (r[0] < 7)
+		return 0;
+
+	// OSXSAVE, then which register states the OS saves
+	__cpuid(r, 1);
+	if (!(r[2] & (1 << 27)))
+		return 0;
+	unsigned long long xcr0 = _xgetbv(0);
+
+	__cpuidex(r, 7, 0);
+	if ((r[1] & (1 << 16)) && (xcr0 & 0xe6U) == 0xe6U)
+		return 2;
+	if ((r[1] & (1 << 5)) && (xcr0 & 0x06U) == 0x06U)
+		return 1;
+	return 0;
+#else
+	// These check OS support for the register state too
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return 2;
+	if (__builtin_cpu_supports("avx2"))
+		return 1;
+	return 0;
+#endif
+}
+
+#endif // LEAF_X86
+
+bool
+leaf_supported (enum leaf_kernel const k)
+{
+	switch (k) {
+	case LEAF_LOOP:
+		return true;
+#ifdef LEAF_X86
+	case LEAF_AVX2:
+		return leaf_cpuid() >= 1;
+	case LEAF_AVX512:
+		return leaf_cpuid() >= 2;
+#endif
+	default:
+		return false;
+	}
+}
+
+leaf_func_t *
+leaf_get (enum leaf_kernel const k)
+{
+	if (!leaf_supported(k))
+		return nullptr;
+
+	switch (k) {
+#ifdef LEAF_X86
+	case LEAF_AVX2:
+		return leaf_avx2;
+	case LEAF_AVX512:
+		return leaf_avx512;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+leaf_check_t *
+leaf_check_get (enum leaf_kernel const k)
+{
+	if (!leaf_supported(k))
+		return nullptr;
+
+	switch (k) {
+#ifdef LEAF_X86
+	case LEAF_AVX2:
+		return leaf_check_avx2;
+	case LEAF_AVX512:
+		return leaf_check_avx512;
+#endif
+	default:
+		return leaf_check_loop;
+	}
+}
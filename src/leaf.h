@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file leaf.h
+ * @brief Vectorized last-level search kernels
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_LEAF_H_
+#define DBS26_SRC_LEAF_H_
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Find the complete sequences among the last-level candidates.
+ *
+ * A candidate is complete if its 6 newest windows and the 5 windows
+ * that wrap around from its end to its beginning are all different and
+ * not in @a map. The parent already has 53 of the 64 windows, so that
+ * is the case exactly when the 11 windows are the ones missing from
+ * @a map.
+ *
+ * @param dst Output array.
+ * @param seq First candidate.
+ * @param end Last candidate.
+ * @param map Windows used by the parent sequence.
+ * @return    Number of sequences written to @a dst.
+ */
+typedef uint32_t leaf_func_t(uint64_t *dst,
+                             uint64_t  seq,
+                             uint64_t  end,
+                             uint64_t  map);
+
+/**
+ * @brief Find the first word of an array that isn't a De Bruijn sequence.
+ *
+ * A word is one if its 64 cyclic windows are all different, which is
+ * the case exactly when their one-hot masks ORed together have every
+ * bit set.
+ *
+ * @param seq Words to check.
+ * @param n   Number of words.
+ * @return    Index of the first word that isn't one, or @a n if every
+ *            word is.
+ */
+typedef size_t leaf_check_t(uint64_t const *seq,
+                            size_t          n);
+
+enum leaf_kernel {
+	LEAF_LOOP,   //!< One candidate at a time, inlined in dbs26.c
+	LEAF_AVX2,   //!< Four candidates at a time
+	LEAF_AVX512, //!< Eight candidates at a time
+};
+
+/**
+ * @brief Check whether the CPU can run a leaf kernel.
+ */
+extern bool
+leaf_supported (enum leaf_kernel k);
+
+/**
+ * @brief Get a leaf kernel.
+ *
+ * @return The kernel, or a null pointer for @ref LEAF_LOOP or if the
+ *         CPU doesn't support the kernel.
+ */
+extern leaf_func_t *
+leaf_get (enum leaf_kernel k);
+
+/**
+ * @brief Get the sequence check of a leaf kernel.
+ *
+ * @return The check, or a null pointer if the CPU doesn't support the
+ *         kernel. @ref LEAF_LOOP has a portable one.
+ */
+extern leaf_check_t *
+leaf_check_get (enum leaf_kernel k);
+
+#endif /* DBS26_SRC_LEAF_H_ */
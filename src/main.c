@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file main.c
+ * @brief Entry point of the dbs26 program
+ * @author Juuso Alasuutari
+ */
+
+#include "compat.h"
+
+#include <stdlib.h>
+
+#include "args.h"
+
+int
+main (int   argc,
+      char *argv[])
+{
+	struct args a = args(argc, argv);
+	return dbs26_run(&a) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,362 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file order.c
+ * @brief Binary De Bruijn sequence search for any supported order
+ * @author Juuso Alasuutari
+ */
+
+#include "compat.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "order.h"
+
+// Silence warning about Spectre mitigation on memory load
+pragma_msvc(warning(disable: 5045))
+
+static force_inline uint32_t
+bit_get (uint64_t const *const seq,
+         uint32_t const        pos)
+{
+	return (uint32_t)(seq[pos >> 6U] >> (63U - (pos & 63U))) & 1U;
+}
+
+static force_inline void
+bit_set (uint64_t *const seq,
+         uint32_t const  pos)
+{
+	seq[pos >> 6U] |= UINT64_C(1) << (63U - (pos & 63U));
+}
+
+static force_inline void
+bit_clr (uint64_t *const seq,
+         uint32_t const  pos)
+{
+	seq[pos >> 6U] &= ~(UINT64_C(1) << (63U - (pos & 63U)));
+}
+
+static force_inline bool
+map_has (uint64_t const *const map,
+         uint32_t const        w)
+{
+	return (map[w >> 6U] >> (w & 63U)) & 1U;
+}
+
+static force_inline void
+map_add (uint64_t *const map,
+         uint32_t const  w)
+{
+	map[w >> 6U] |= UINT64_C(1) << (w & 63U);
+}
+
+static force_inline void
+map_del (uint64_t *const map,
+         uint32_t const  w)
+{
+	map[w >> 6U] &= ~(UINT64_C(1) << (w & 63U));
+}
+
+/** @brief Get the window of @a n bits that ends at bit @a pos.
+ *
+ * @note @a pos must be at least `n - 1`.
+ */
+static force_inline uint32_t
+node_window (uint64_t const *const seq,
+             uint32_t const        n,
+             uint32_t const        pos)
+{
+	uint32_t w = 0U;
+	for (uint32_t i = pos + 1U - n; i <= pos; ++i)
+		w = w << 1U | bit_get(seq, i);
+	return w;
+}
+
+/** @brief Check that the windows which wrap around from the end of a
+ *         complete sequence back to its beginning are all unused.
+ *
+ * @param map Windows used by the sequence.
+ * @param n   Order.
+ * @param w   The last window that doesn't wrap around.
+ */
+static force_inline bool
+node_wraps (uint64_t const *const map,
+            uint32_t const        n,
+            uint32_t              w)
+{
+	// The sequence begins with a one followed by zeros
+	uint32_t const mask = (1U << n) - 1U;
+	w = (w << 1U | 1U) & mask;
+	for (uint32_t i = 1U; i < n; ++i, w = (w << 1U) & mask) {
+		if (map_has(map, w))
+			return false;
+	}
+	return true;
+}
+
+int
+node_root (struct node    *const dst,
+           uint32_t const        n,
+           uint64_t const *const prefix,
+           uint32_t              len)
+{
+	uint32_t const seq_len = 1U << n;
+	if (n < ORDER_MIN || n > ORDER_MAX || len > seq_len)
+		return EINVAL;
+
+	// The prefix is given in output form, which is the search form
+	// rotated left by one. The search form therefore begins with the
+	// last output bit, which is always set, followed by the prefix.
+	if (len == seq_len) {
+		if (!bit_get(prefix, len - 1U))
+			return EINVAL;
+		--len;
+	}
+
+	struct node r = {.len = n + 2U};
+	bit_set(r.seq, 0U);
+	bit_set(r.seq, n + 1U);
+	map_add(r.map, 1U << (n - 1U));
+	map_add(r.map, 0U);
+	map_add(r.map, 1U);
+
+	for (uint32_t i = 0U; i < len; ++i) {
+		uint32_t pos = i + 1U;
+		uint32_t b = bit_get(prefix, i);
+		if (pos < r.len) {
+			if (b != bit_get(r.seq, pos))
+				return EINVAL;
+			continue;
+		}
+
+		if (b)
+			bit_set(r.seq, pos);
+		uint32_t w = node_window(r.seq, n, pos);
+		if (map_has(r.map, w))
+			return EINVAL;
+		map_add(r.map, w);
+		r.len = pos + 1U;
+	}
+
+	if (r.len == seq_len &&
+	    !node_wraps(r.map, n, node_window(r.seq, n, r.len - 1U)))
+		return EINVAL;
+
+	*dst = r;
+	return 0;
+}
+
+static int
+node_vec_push (struct node_vec *const   v,
+               struct node const *const x)
+{
+	if (v->len == v->cap) {
+		size_t cap = v->cap ? v->cap * 2U : 64U;
+		struct node *p = realloc(v->ptr, cap * sizeof *p);
+		if (!p)
+			return ENOMEM;
+		v->ptr = p;
+		v->cap = cap;
+	}
+	v->ptr[v->len++] = *x;
+	return 0;
+}
+
+int
+u64_vec_reserve (struct u64_vec *const v,
+                 size_t const          n)
+{
+	if (v->cap - v->len < n) {
+		size_t cap = v->cap ? v->cap : 1024U;
+		while (cap - v->len < n)
+			cap *= 2U;
+		uint64_t *p = realloc(v->ptr, cap * sizeof *p);
+		if (!p)
+			return ENOMEM;
+		v->ptr = p;
+		v->cap = cap;
+	}
+	return 0;
+}
+
+/** @brief Store a complete sequence in output form.
+ */
+static force_inline void
+node_output (uint64_t *const       dst,
+             uint64_t const *const seq,
+             uint32_t const        n)
+{
+	if (n < 6U) {
+		uint32_t const len = 1U << n;
+		uint64_t const mask = (UINT64_C(1) << len) - 1U;
+		dst[0] = ((seq[0] >> (64U - len)) << 1U & mask) | 1U;
+		return;
+	}
+
+	uint32_t const words = order_words(n);
+	for (uint32_t i = 0U; i + 1U < words; ++i)
+		dst[i] = seq[i] << 1U | seq[i + 1U] >> 63U;
+	dst[words - 1U] = seq[words - 1U] << 1U | 1U;
+}
+
+/**
+ * @brief Depth-first search one bit at a time.
+ *
+ * Each step appends a zero or a one and accepts it only if the window
+ * it completes is unused, so every node visited is a valid prefix, and
+ * trying zero before one keeps the results in ascending order. Visited
+ * windows are removed from the map again on the way back, so the whole
+ * search state is one sequence, one map and the current window.
+ *
+ * @param src    Node to start from.
+ * @param n      Order.
+ * @param stop   Length at which to report nodes. If this is the full
+ *               sequence length, only complete sequences are reported.
+ * @param expand Whether to report nodes (true) or output sequences.
+ * @param dst    A `struct node_vec` or `struct u64_vec`.
+ * @return       0 on success, or ENOMEM.
+ */
+static force_inline int
+walk (struct node const *const src,
+      uint32_t const           n,
+      uint32_t const           stop,
+      bool const               expand,
+      void *const              dst)
+{
+	uint32_t const mask = (1U << n) - 1U;
+	uint32_t const top = src->len;
+	uint32_t const words = order_words(n);
+	struct node x = *src;
+	uint32_t pos = top;
+	uint32_t w = node_window(x.seq, n, pos - 1U);
+	uint32_t y;
+
+	if (pos == stop)
+		goto leaf;
+
+	for (;;) {
+		y = (w << 1U) & mask;
+		if (map_has(x.map, y)) {
+			y |= 1U;
+			if (map_has(x.map, y))
+				goto back;
+		}
+
+	place:
+		map_add(x.map, y);
+		if (y & 1U)
+			bit_set(x.seq, pos);
+		w = y;
+		if (++pos < stop)
+			continue;
+
+	leaf:
+		if (pos == mask + 1U && !node_wraps(x.map, n, w))
+			goto back;
+
+		if (expand) {
+			x.len = pos;
+			if (node_vec_push(dst, &x))
+				return ENOMEM;
+		} else {
+			struct u64_vec *v = dst;
+			if (u64_vec_reserve(v, words))
+				return ENOMEM;
+			node_output(&v->ptr[v->len], x.seq, n);
+			v->len += words;
+		}
+
+	back:
+		for (;;) {
+			if (pos == top)
+				return 0;
+			--pos;
+			map_del(x.map, w);
+			uint32_t b = w & 1U;
+			y = w | 1U;
+			w = w >> 1U | bit_get(x.seq, pos - n) << (n - 1U);
+			if (b) {
+				bit_clr(x.seq, pos);
+				continue;
+			}
+			if (!map_has(x.map, y))
+				goto place;
+		}
+	}
+}
+
+int
+node_expand (struct node_vec   *const dst,
+             struct node const *const src,
+             uint32_t const           n,
+             uint32_t                 len)
+{
+	uint32_t const seq_len = 1U << n;
+	if (len > seq_len)
+		len = seq_len;
+	if (len < src->len)
+		return EINVAL;
+	return walk(src, n, len, true, dst);
+}
+
+int
+order_search (struct u64_vec    *const dst,
+              struct node const *const src,
+              uint32_t const           n)
+{
+	return walk(src, n, 1U << n, false, dst);
+}
+
+void
+order_sample (uint64_t *const   dst,
+              uint32_t const    n,
+              struct rng *const r)
+{
+	uint32_t const mask = (1U << (n - 1U)) - 1U;
+	uint8_t next[1U << (ORDER_MAX - 1U)];
+	uint64_t tree[SEQ_WORDS_MAX] = {0};
+	uint64_t bits = 0U;
+	uint32_t left = 0U;
+
+	// Wilson's algorithm: walk randomly from each vertex not yet in
+	// the tree until one is hit, then add the path with the loops
+	// erased, which is what the last exit from each vertex gives.
+	next[0] = 0U;
+	map_add(tree, 0U);
+	for (uint32_t i = 1U; i <= mask; ++i) {
+		for (uint32_t u = i; !map_has(tree, u); ) {
+			if (!left) {
+				bits = rng_next(r);
+				left = 64U;
+			}
+			next[u] = (uint8_t)(bits & 1U);
+			bits >>= 1U;
+			--left;
+			u = (u << 1U | next[u]) & mask;
+		}
+		for (uint32_t u = i; !map_has(tree, u); ) {
+			map_add(tree, u);
+			u = (u << 1U | next[u]) & mask;
+		}
+	}
+
+	// Walk the circuit from the all-zeros window, leaving each vertex
+	// by its tree edge only once the other one is used. The last n
+	// bits are always a one and the zeros of the first window.
+	uint64_t used[SEQ_WORDS_MAX] = {0};
+	uint64_t seq[SEQ_WORDS_MAX] = {0};
+	uint32_t u = 0U;
+	map_add(used, 0U);
+	bit_set(seq, 0U);
+	for (uint32_t pos = n + 1U; pos < 1U << n; ++pos) {
+		uint32_t w = u << 1U | (next[u] ^ 1U);
+		if (map_has(used, w))
+			w ^= 1U;
+		map_add(used, w);
+		if (w & 1U)
+			bit_set(seq, pos);
+		u = w & mask;
+	}
+
+	node_output(dst, seq, n);
+}
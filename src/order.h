@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file order.h
+ * @brief Binary De Bruijn sequence search for any supported order
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_ORDER_H_
+#define DBS26_SRC_ORDER_H_
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
+
+#define ORDER_MIN 3U
+#define ORDER_MAX 8U
+
+/** @brief Maximum number of 64-bit words in a sequence or window map.
+ */
+#define SEQ_WORDS_MAX (1U << (ORDER_MAX - 6U))
+
+/**
+ * @brief A partial binary De Bruijn sequence of order n.
+ *
+ * The bits are stored most significant first: bit @a i of the sequence
+ * is bit `63 - i % 64` of word `i / 64`. Sequences are kept rotated so
+ * that they begin with a one followed by the run of n zeros, which is
+ * the form the search works in. The sequences that are output are the
+ * same ones rotated left by one bit, i.e. beginning with the zero run.
+ *
+ * Bit @a w of @a map is set if the window of n bits with value @a w is
+ * already present in the sequence.
+ */
+struct node {
+	uint64_t seq[SEQ_WORDS_MAX];
+	uint64_t map[SEQ_WORDS_MAX];
+	uint32_t len;
+};
+
+struct node_vec {
+	struct node *ptr;
+	size_t       len;
+	size_t       cap;
+};
+
+struct u64_vec {
+	uint64_t *ptr;
+	size_t    len;
+	size_t    cap;
+};
+
+/** @brief Get the number of 64-bit words used to output one sequence.
+ */
+static const_inline uint32_t
+order_words (uint32_t const n)
+{
+	return n > 6U ? 1U << (n - 6U) : 1U;
+}
+
+/**
+ * @brief Make room for @a n more words in @a v.
+ *
+ * @return 0 on success, or ENOMEM.
+ */
+extern int
+u64_vec_reserve (struct u64_vec *v,
+                 size_t          n);
+
+/**
+ * @brief Create the root node of all sequences of order @a n whose
+ *        output form begins with the given prefix.
+ *
+ * @param dst    Where to store the node.
+ * @param n      Order of the sequences.
+ * @param prefix Prefix bits, most significant first, using the same
+ *               layout as @ref node::seq.
+ * @param len    Number of prefix bits.
+ * @return       0 on success, or EINVAL if the prefix can't occur in
+ *               any sequence of order @a n.
+ */
+extern int
+node_root (struct node    *dst,
+           uint32_t        n,
+           uint64_t const *prefix,
+           uint32_t        len);
+
+/**
+ * @brief Append every descendant of @a src that is @a len bits long.
+ *
+ * Descendants are appended in ascending order. If @a len is the full
+ * sequence length, only complete sequences are included.
+ *
+ * @return 0 on success, or ENOMEM.
+ */
+extern int
+node_expand (struct node_vec   *dst,
+             struct node const *src,
+             uint32_t           n,
+             uint32_t           len);
+
+/**
+ * @brief Append every complete sequence that descends from @a src.
+ *
+ * Sequences are appended in ascending order and in output form, each
+ * as @ref order_words() words with the most significant word first.
+ *
+ * @return 0 on success, or ENOMEM.
+ */
+extern int
+order_search (struct u64_vec    *dst,
+              struct node const *src,
+              uint32_t           n);
+
+/**
+ * @brief Pick a sequence of order @a n uniformly at random.
+ *
+ * Rather than searching, this relies on the BEST theorem: the cycles
+ * of the De Bruijn graph of order n - 1 that use every edge once are
+ * the sequences, and each one corresponds to exactly one spanning tree
+ * of the graph directed towards the all-zeros vertex. Such a tree is
+ * picked uniformly with Wilson's algorithm, and the sequence is then
+ * read off by walking the graph without taking a tree edge until the
+ * other way out is used up.
+ *
+ * @param dst Where to store the sequence in output form, as
+ *            @ref order_words() words.
+ * @param n   Order.
+ * @param r   Random number generator.
+ */
+extern void
+order_sample (uint64_t   *dst,
+              uint32_t    n,
+              struct rng *r);
+
+#endif /* DBS26_SRC_ORDER_H_ */
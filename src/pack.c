@@ -0,0 +1,560 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file pack.c
+ * @brief Compact file format for sorted order 6 sequences
+ * @author Juuso Alasuutari
+ */
+
+#include "compat.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bits.h"
+#include "leaf.h"
+#include "pack.h"
+#include "window.h"
+
+#if defined __x86_64__ || defined _M_X64
+# define PACK_X86
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  define pack_target(...)
+# else
+#  define pack_target(...) __attribute__((target(__VA_ARGS__)))
+# endif
+#endif
+
+#define PACK_VERSION 1U
+
+// Low bits are stored and loaded 8 bytes at a time at any bit offset
+#define PACK_LOW_MAX 56U
+
+// Bits that the leaf kernels can fill in, and the always set lowest bit
+#define PACK_SHIFT 7U
+
+static char const pack_magic[8] = {'D', 'B', 'S', '2', '6', 'P', 'A', 'K'};
+
+static const_inline uint64_t
+le64 (uint64_t const x)
+{
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return __builtin_bswap64(x);
+#else
+	return x;
+#endif
+}
+
+static force_inline uint64_t
+get64 (uint8_t const *const src)
+{
+	uint64_t x;
+	(void)memcpy(&x, src, sizeof x);
+	return le64(x);
+}
+
+static force_inline void
+put64 (uint8_t *const dst,
+       uint64_t const x)
+{
+	uint64_t const y = le64(x);
+	(void)memcpy(dst, &y, sizeof y);
+}
+
+/**
+ * @brief Make room for @a need elements in an array.
+ *
+ * @return The array, or a null pointer if it couldn't be reallocated.
+ */
+static void *
+pack_grow (void *const   ptr,
+           size_t *const cap,
+           size_t const  need,
+           size_t const  size)
+{
+	if (need <= *cap)
+		return ptr;
+
+	size_t n = *cap ? *cap : 64U;
+	while (n < need)
+		n *= 2U;
+	void *p = realloc(ptr, n * size);
+	if (p)
+		*cap = n;
+	return p;
+}
+
+/**
+ * @brief Find the ways to complete a 58-bit prefix.
+ *
+ * @param dst    Output array with room for 64 sequences.
+ * @param prefix A sequence shifted right by @ref PACK_SHIFT bits.
+ * @param leaf   Leaf kernel, or a null pointer for the scalar loop.
+ * @return       Number of sequences written to @a dst, in order.
+ */
+static uint32_t
+pack_complete (uint64_t *const    dst,
+               uint64_t const     prefix,
+               leaf_func_t *const leaf)
+{
+	// The parent of the leaf candidates in search form, which has its
+	// leading 1 where the sequences have it in the lowest bit
+	uint64_t const p = prefix | UINT64_C(1) << 57U;
+	uint64_t const map = window_bits(p, 53U);
+	uint64_t const seq = p << 6U;
+	if (leaf)
+		return leaf(dst, seq, seq | 63U, map);
+
+	uint32_t n = 0U;
+	for (uint64_t ext = window_ext(p, map); ext; ext &= ext - 1U) {
+		uint64_t const c = seq | count_lsb_1(~ext);
+		uint64_t const r = c << 5U | c >> 59U;
+		if ((map | window_bits(c, 6U) | window_bits(r, 5U)) == UINT64_MAX)
+			dst[n++] = c << 1U | c >> 63U;
+	}
+	return n;
+}
+
+/**
+ * @brief Check whether every prefix in @a v comes with all of its
+ *        completions, and nothing else.
+ */
+static bool
+pack_tail_ok (uint64_t const *const v,
+              size_t const          n,
+              leaf_func_t *const    leaf)
+{
+	uint64_t c[64];
+
+	for (size_t i = 0U, j; i < n; i = j) {
+		uint64_t const h = v[i] >> PACK_SHIFT;
+		for (j = i + 1U; j < n && v[j] >> PACK_SHIFT == h; ++j);
+		if (pack_complete(c, h, leaf) != j - i ||
+		    memcmp(c, &v[i], (j - i) * sizeof *c))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Append one block to @a p.
+ */
+static int
+pack_block (struct pack *const    p,
+            uint64_t const *const v,
+            size_t const          n,
+            bool const            tail)
+{
+	uint32_t const s = tail ? PACK_SHIFT : 0U;
+	uint64_t const base = v[0] >> s;
+	uint64_t const u = (v[n - 1U] >> s) - base;
+	uint32_t l = 0U;
+	if (u > n) {
+		l = 63U - (uint32_t)count_msb_1(~(u / n));
+		if (l > PACK_LOW_MAX)
+			l = PACK_LOW_MAX;
+	}
+
+	size_t const low = (n * l + 7U) / 8U;
+	size_t const size = 1U + low + ((size_t)(u >> l) + n + 7U) / 8U;
+
+	// The low bits are ORed in 8 bytes at a time, hence the slack
+	uint8_t *data = pack_grow(p->data, &p->cap, p->size + size + 8U, 1U);
+	if (!data)
+		return ENOMEM;
+	p->data = data;
+	struct pack_entry *index = pack_grow(p->index, &p->max, p->len + 1U,
+	                                     sizeof *index);
+	if (!index)
+		return ENOMEM;
+	p->index = index;
+
+	uint8_t *const b = &data[p->size];
+	(void)memset(b, 0, size + 8U);
+	b[0] = (uint8_t)(l << 1U | tail);
+
+	uint64_t const mask = (UINT64_C(1) << l) - 1U;
+	for (size_t i = 0U; i < n; ++i) {
+		uint64_t const x = (v[i] >> s) - base;
+		size_t const lb = i * l;
+		size_t const hb = (size_t)(x >> l) + i;
+		put64(&b[1U + lb / 8U], get64(&b[1U + lb / 8U])
+		                        | (x & mask) << (lb % 8U));
+		b[1U + low + hb / 8U] |= (uint8_t)(1U << (hb % 8U));
+	}
+
+	index[p->len++] = (struct pack_entry){
+		.first = v[0],
+		.where = (uint64_t)p->size << 16U | (n - 1U)
+	};
+	p->size += size;
+	p->count += n;
+	return 0;
+}
+
+int
+pack_encode (struct pack *const    p,
+             uint64_t const *const v,
+             size_t const          n,
+             leaf_func_t *const    leaf)
+{
+	for (size_t i = 0U, j; i < n; i = j) {
+		j = n - i > PACK_BLOCK_LEN ? i + PACK_BLOCK_LEN : n;
+
+		// End the block between two prefixes if possible, so that
+		// it can be in tail form
+		size_t k = j;
+		while (k > i && k < n &&
+		       v[k - 1U] >> PACK_SHIFT == v[k] >> PACK_SHIFT)
+			--k;
+		if (k > i)
+			j = k;
+
+		int e = pack_block(p, &v[i], j - i,
+		                   pack_tail_ok(&v[i], j - i, leaf));
+		if (e)
+			return e;
+	}
+
+	return 0;
+}
+
+void
+pack_free (struct pack *const p)
+{
+	free(p->data);
+	free(p->index);
+	*p = (struct pack){0};
+}
+
+int
+pack_write_head (FILE *const        f,
+                 struct pack *const idx)
+{
+	uint8_t b[PACK_HEAD_SIZE];
+	(void)memcpy(b, pack_magic, sizeof pack_magic);
+	put64(&b[8], (uint64_t)PACK_BLOCK_LEN << 32U | PACK_VERSION);
+
+	if (fwrite(b, 1U, sizeof b, f) != sizeof b)
+		return errno ? errno : EIO;
+
+	idx->size = sizeof b;
+	return 0;
+}
+
+int
+pack_write (FILE *const              f,
+            struct pack *const       dst,
+            struct pack const *const src)
+{
+	if (!src->len)
+		return 0;
+
+	struct pack_entry *index = pack_grow(dst->index, &dst->max,
+	                                     dst->len + src->len,
+	                                     sizeof *index);
+	if (!index)
+		return ENOMEM;
+	dst->index = index;
+
+	if (src->size && fwrite(src->data, 1U, src->size, f) != src->size)
+		return errno ? errno : EIO;
+
+	for (size_t i = 0U; i < src->len; ++i) {
+		index[dst->len++] = (struct pack_entry){
+			.first = src->index[i].first,
+			.where = src->index[i].where + ((uint64_t)dst->size << 16U)
+		};
+	}
+
+	dst->size += src->size;
+	dst->count += src->count;
+	return 0;
+}
+
+int
+pack_write_tail (FILE *const              f,
+                 struct pack const *const idx)
+{
+	for (size_t i = 0U; i < idx->len; ++i) {
+		uint8_t b[sizeof *idx->index];
+		put64(&b[0], idx->index[i].first);
+		put64(&b[8], idx->index[i].where);
+		if (fwrite(b, 1U, sizeof b, f) != sizeof b)
+			return errno ? errno : EIO;
+	}
+
+	uint8_t b[PACK_TAIL_SIZE];
+	put64(&b[0], idx->count);
+	put64(&b[8], idx->len);
+	put64(&b[16], idx->size);
+	(void)memcpy(&b[24], pack_magic, sizeof pack_magic);
+
+	if (fwrite(b, 1U, sizeof b, f) != sizeof b)
+		return errno ? errno : EIO;
+
+	return 0;
+}
+
+/**
+ * @brief Get the low bits of @a dst[i] to @a dst[n - 1].
+ */
+static force_inline void
+pack_low_loop (uint64_t *const      dst,
+               uint8_t const *const src,
+               size_t               i,
+               size_t const         n,
+               uint32_t const       l)
+{
+	uint64_t const mask = (UINT64_C(1) << l) - 1U;
+	for (; i < n; ++i)
+		dst[i] = get64(&src[i * l / 8U]) >> (i * l % 8U) & mask;
+}
+
+#ifdef PACK_X86
+
+/*
+ * The low bits of four elements are fetched with one gather, each lane
+ * loading the 8 bytes at which its element starts. A variable shift
+ * then drops the bits that belong to the element before it.
+ */
+
+pack_target("avx2") static void
+pack_low_avx2 (uint64_t *const      dst,
+               uint8_t const *const src,
+               size_t const         n,
+               uint32_t const       l)
+{
+	__m256i const mask = _mm256_set1_epi64x((long long)((UINT64_C(1) << l)
+	                                                    - 1U));
+	__m256i const seven = _mm256_set1_epi64x(7);
+	__m256i const step = _mm256_set1_epi64x((long long)l * 4);
+	__m256i pos = _mm256_setr_epi64x(0, (long long)l,
+	                                 (long long)l * 2, (long long)l * 3);
+	size_t i = 0U;
+
+	for (; i + 4U <= n; i += 4U, pos = _mm256_add_epi64(pos, step)) {
+		__m256i w = _mm256_i64gather_epi64(
+			(long long const *)(void const *)src,
+			_mm256_srli_epi64(pos, 3), 1);
+		w = _mm256_srlv_epi64(w, _mm256_and_si256(pos, seven));
+		_mm256_storeu_si256((__m256i *)(void *)&dst[i],
+		                    _mm256_and_si256(w, mask));
+	}
+
+	pack_low_loop(dst, src, i, n, l);
+}
+
+#endif // PACK_X86
+
+/**
+ * @brief Decode a block.
+ *
+ * @param dst    Output array.
+ * @param b      The block, followed by at least 8 readable bytes.
+ * @param size   Size of the block in bytes.
+ * @param n      Number of sequences in the block.
+ * @param first  First sequence, from the index.
+ * @param leaf   Leaf kernel, or a null pointer.
+ * @param gather Whether to use pack_low_avx2().
+ * @return       0 on success, otherwise an error code.
+ */
+static int
+pack_unblock (uint64_t *const      dst,
+              uint8_t const *const b,
+              size_t const         size,
+              size_t const         n,
+              uint64_t const       first,
+              leaf_func_t *const   leaf,
+              bool const           gather)
+{
+	uint32_t const l = b[0] >> 1U;
+	bool const tail = b[0] & 1U;
+	size_t const low = (n * l + 7U) / 8U;
+	if (l > PACK_LOW_MAX || 1U + low > size)
+		return EBADMSG;
+
+#ifdef PACK_X86
+	if (gather)
+		pack_low_avx2(dst, &b[1], n, l);
+	else
+#endif
+		pack_low_loop(dst, &b[1], 0U, n, l);
+	(void)gather;
+
+	// The n-th set bit of the upper bits is at the n-th element's
+	// upper bits plus n
+	size_t i = 0U;
+	for (size_t w = 1U + low; i < n && w < size; w += 8U) {
+		uint64_t x = get64(&b[w]);
+		for (; x && i < n; x &= x - 1U, ++i) {
+			size_t const bit = (w - 1U - low) * 8U
+			                   + (size_t)count_lsb_1(~x);
+			dst[i] |= (uint64_t)(bit - i) << l;
+		}
+	}
+	if (i < n)
+		return EBADMSG;
+
+	uint32_t const s = tail ? PACK_SHIFT : 0U;
+	uint64_t const base = first >> s;
+	for (i = 0U; i < n; ++i)
+		dst[i] += base;
+
+	for (size_t k = 0U, j; tail && k < n; k = j) {
+		uint64_t c[64];
+		for (j = k + 1U; j < n && dst[j] == dst[k]; ++j);
+		if (pack_complete(c, dst[k], leaf) != j - k)
+			return EBADMSG;
+		(void)memcpy(&dst[k], c, (j - k) * sizeof *c);
+	}
+
+	return dst[0] == first ? 0 : EBADMSG;
+}
+
+int
+pack_open (struct pack_file *const r,
+           char const *const       path,
+           leaf_func_t *const      leaf)
+{
+	*r = (struct pack_file){
+		.leaf = leaf,
+#ifdef PACK_X86
+		.gather = leaf_supported(LEAF_AVX2),
+#endif
+	};
+
+	r->f = fopen(path, "rb");
+	if (!r->f)
+		return errno ? errno : EIO;
+
+	int e = EBADMSG;
+	uint8_t head[PACK_HEAD_SIZE], tail[PACK_TAIL_SIZE];
+	if (fread(head, 1U, sizeof head, r->f) != sizeof head ||
+	    fseek(r->f, -(long)sizeof tail, SEEK_END) ||
+	    fread(tail, 1U, sizeof tail, r->f) != sizeof tail)
+		goto fail;
+
+	uint64_t const ver = get64(&head[8]);
+	uint64_t const count = get64(&tail[0]);
+	uint64_t const blocks = get64(&tail[8]);
+	r->end = get64(&tail[16]);
+	if (memcmp(head, pack_magic, sizeof pack_magic) ||
+	    memcmp(&tail[24], pack_magic, sizeof pack_magic) ||
+	    (uint32_t)ver != PACK_VERSION ||
+	    ver >> 32U > PACK_BLOCK_LEN ||
+	    r->end < sizeof head || r->end > LONG_MAX ||
+	    blocks > (SIZE_MAX >> 5U))
+		goto fail;
+
+	r->blocks = (size_t)blocks;
+	r->index = malloc((r->blocks ? r->blocks : 1U) * sizeof *r->index);
+	r->rank = malloc((r->blocks + 1U) * sizeof *r->rank);
+	if (!r->index || !r->rank) {
+		e = ENOMEM;
+		goto fail;
+	}
+
+	if (fseek(r->f, (long)r->end, SEEK_SET))
+		goto fail;
+
+	// Blocks are back to back, in order, starting right after the header
+	uint64_t sum = 0U, off = sizeof head - 1U;
+	for (size_t i = 0U; i < r->blocks; ++i) {
+		uint8_t b[sizeof *r->index];
+		if (fread(b, 1U, sizeof b, r->f) != sizeof b)
+			goto fail;
+		r->index[i].first = get64(&b[0]);
+		r->index[i].where = get64(&b[8]);
+
+		uint64_t const o = r->index[i].where >> 16U;
+		if (o <= off || o >= r->end || (!i && o != sizeof head))
+			goto fail;
+		off = o;
+		r->rank[i] = sum;
+		sum += (r->index[i].where & 0xffffU) + 1U;
+	}
+	r->rank[r->blocks] = sum;
+	if (sum != count)
+		goto fail;
+
+	return 0;
+
+fail:
+	if (e == EBADMSG && ferror(r->f))
+		e = errno ? errno : EIO;
+	pack_close(r);
+	return e;
+}
+
+void
+pack_close (struct pack_file *const r)
+{
+	if (r->f)
+		(void)fclose(r->f);
+	free(r->index);
+	free(r->rank);
+	free(r->buf);
+	*r = (struct pack_file){0};
+}
+
+int
+pack_read (struct pack_file *const r,
+           uint64_t                *dst,
+           uint64_t                 first,
+           size_t                   n)
+{
+	if (first > pack_count(r) || n > pack_count(r) - first)
+		return ERANGE;
+	if (!n)
+		return 0;
+
+	// Last block that starts at or before the first sequence
+	size_t lo = 0U, hi = r->blocks;
+	while (hi - lo > 1U) {
+		size_t mid = lo + (hi - lo) / 2U;
+		if (r->rank[mid] <= first)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	if (fseek(r->f, (long)(r->index[lo].where >> 16U), SEEK_SET))
+		return errno ? errno : EIO;
+
+	for (size_t b = lo; n; ++b) {
+		uint64_t const off = r->index[b].where >> 16U;
+		uint64_t const end = b + 1U < r->blocks
+		                     ? r->index[b + 1U].where >> 16U : r->end;
+		size_t const len = (size_t)(r->index[b].where & 0xffffU) + 1U;
+		if (end <= off || len > PACK_BLOCK_LEN)
+			return EBADMSG;
+
+		size_t const size = (size_t)(end - off);
+		uint8_t *buf = pack_grow(r->buf, &r->buf_cap, size + 8U, 1U);
+		if (!buf)
+			return ENOMEM;
+		r->buf = buf;
+		if (fread(buf, 1U, size, r->f) != size)
+			return ferror(r->f) && errno ? errno : EBADMSG;
+		(void)memset(&buf[size], 0, 8U);
+
+		int e = pack_unblock(r->seq, buf, size, len, r->index[b].first,
+		                     r->leaf, r->gather);
+		if (e)
+			return e;
+
+		size_t const skip = (size_t)(first - r->rank[b]);
+		size_t const k = len - skip < n ? len - skip : n;
+		(void)memcpy(dst, &r->seq[skip], k * sizeof *dst);
+		dst += k;
+		first += k;
+		n -= k;
+	}
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file pack.h
+ * @brief Compact file format for sorted order 6 sequences
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_PACK_H_
+#define DBS26_SRC_PACK_H_
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "leaf.h"
+
+/*
+ * A packed file is a 16-byte header, a run of blocks, an index with an
+ * entry per block, and a 32-byte trailer. Everything is little-endian.
+ *
+ *   header:  "DBS26PAK", u32 version, u32 maximum block length
+ *   index:   u64 first sequence, u64 byte offset << 16 | (length - 1)
+ *   trailer: u64 sequence count, u64 block count, u64 index offset,
+ *            "DBS26PAK"
+ *
+ * A block holds up to @ref PACK_BLOCK_LEN consecutive sequences as an
+ * Elias-Fano coded list of their differences from the first one, which
+ * is in the index. The first byte of a block is its low bit width << 1,
+ * and the lowest bit of that byte tells whether the block is in tail
+ * form. The low bits of every element follow, then the upper bits in
+ * unary.
+ *
+ * In tail form only the highest 57 bits of each sequence are coded. The
+ * lowest bit of every sequence is 1, and the 6 bits above it are always
+ * some of the ways to complete the remaining 58-bit prefix, which the
+ * leaf kernels enumerate. When a block has every sequence that shares
+ * such a prefix with any of its own, the decoder can run the same
+ * search and take the n-th completion for the n-th copy of a prefix.
+ * The encoder checks this for each block and falls back to coding the
+ * sequences in full where it doesn't hold.
+ */
+
+#define PACK_BLOCK_LEN 256U
+#define PACK_HEAD_SIZE 16U
+#define PACK_TAIL_SIZE 32U
+
+/**
+ * @brief Index entry of a block.
+ */
+struct pack_entry {
+	uint64_t first; //!< First sequence in the block
+	uint64_t where; //!< Byte offset << 16 | (number of sequences - 1)
+};
+
+/**
+ * @brief Encoded blocks and their index.
+ *
+ * The offsets in @a index are relative to the beginning of @a data
+ * until the blocks are written out. While a file is being written,
+ * @a size is the number of bytes written so far.
+ */
+struct pack {
+	uint8_t           *data;
+	size_t             size;
+	size_t             cap;
+	struct pack_entry *index;
+	size_t             len;
+	size_t             max;
+	uint64_t           count; //!< Number of sequences
+};
+
+/**
+ * @brief Reader of a packed file.
+ */
+struct pack_file {
+	FILE              *f;
+	leaf_func_t       *leaf;
+	struct pack_entry *index;
+	uint64_t          *rank;   //!< Position of each block, and the count
+	size_t             blocks;
+	uint64_t           end;    //!< Byte offset of the index
+	uint8_t           *buf;    //!< One block, see pack_read()
+	size_t             buf_cap;
+	bool               gather; //!< Unpack the low bits with AVX2
+	uint64_t           seq[PACK_BLOCK_LEN];
+};
+
+/**
+ * @brief Encode a sorted array of order 6 sequences.
+ *
+ * The blocks are appended to @a p.
+ *
+ * @param p    Output.
+ * @param v    Sequences.
+ * @param n    Length of @a v.
+ * @param leaf Leaf kernel for completing prefixes, or a null pointer.
+ * @return     0 on success, otherwise an error code.
+ */
+extern int
+pack_encode (struct pack    *p,
+             uint64_t const *v,
+             size_t          n,
+             leaf_func_t    *leaf);
+
+/**
+ * @brief Free the buffers of @a p and reset it.
+ */
+extern void
+pack_free (struct pack *p);
+
+/**
+ * @brief Write the header of a packed file.
+ *
+ * @param f   Output file.
+ * @param idx Where to collect the index of the file, see pack_write().
+ *            Must be zero-initialized.
+ * @return    0 on success, otherwise an error code.
+ */
+extern int
+pack_write_head (FILE        *f,
+                 struct pack *idx);
+
+/**
+ * @brief Write the blocks of @a src and add their index entries to
+ *        @a dst, which tracks the whole file.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+pack_write (FILE              *f,
+            struct pack       *dst,
+            struct pack const *src);
+
+/**
+ * @brief Write the index and trailer of a packed file.
+ *
+ * @param f   Output file.
+ * @param idx The index collected by pack_write().
+ * @return    0 on success, otherwise an error code.
+ */
+extern int
+pack_write_tail (FILE              *f,
+                 struct pack const *idx);
+
+/**
+ * @brief Open a packed file for reading.
+ *
+ * @param r    Reader to initialize.
+ * @param path File name.
+ * @param leaf Leaf kernel for completing prefixes, or a null pointer.
+ * @return     0 on success, otherwise an error code.
+ */
+extern int
+pack_open (struct pack_file *r,
+           char const       *path,
+           leaf_func_t      *leaf);
+
+/**
+ * @brief Close a packed file.
+ */
+extern void
+pack_close (struct pack_file *r);
+
+/**
+ * @brief Get the number of sequences in a packed file.
+ */
+static force_inline uint64_t
+pack_count (struct pack_file const *r)
+{
+	return r->rank[r->blocks];
+}
+
+/**
+ * @brief Decode sequences from a packed file.
+ *
+ * Seeks with the index to the block that holds sequence @a first.
+ *
+ * @param r     Reader.
+ * @param dst   Output array.
+ * @param first Index of the first sequence to decode.
+ * @param n     Number of sequences to decode.
+ * @return      0 on success, otherwise an error code.
+ */
+extern int
+pack_read (struct pack_file *r,
+           uint64_t         *dst,
+           uint64_t          first,
+           size_t            n);
+
+#endif /* DBS26_SRC_PACK_H_ */
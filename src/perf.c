@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file perf.c
+ * @brief Hardware performance counters of the calling thread
+ * @author Juuso Alasuutari
+ */
+
+#include "compat.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __linux__
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include "perf.h"
+
+#ifdef __linux__
+/**
+ * @brief The type and config of each event.
+ */
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} perf_events[PERF_EVENTS] = {
+	[PERF_CYCLES]        = {PERF_TYPE_HARDWARE,
+	                        PERF_COUNT_HW_CPU_CYCLES},
+	[PERF_INSTRUCTIONS]  = {PERF_TYPE_HARDWARE,
+	                        PERF_COUNT_HW_INSTRUCTIONS},
+	[PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE,
+	                        PERF_COUNT_HW_BRANCH_MISSES},
+	[PERF_L1D_MISSES]    = {PERF_TYPE_HW_CACHE,
+	                        PERF_COUNT_HW_CACHE_L1D
+	                        | PERF_COUNT_HW_CACHE_OP_READ << 8U
+	                        | PERF_COUNT_HW_CACHE_RESULT_MISS << 16U},
+};
+
+static int
+perf_event_open (enum perf_event const e,
+                 int const             group)
+{
+	struct perf_event_attr attr;
+	(void)memset(&attr, 0, sizeof attr);
+	attr.size = sizeof attr;
+	attr.type = perf_events[e].type;
+	attr.config = perf_events[e].config;
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.disabled = group < 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group,
+	                    PERF_FLAG_FD_CLOEXEC);
+}
+#endif // __linux__
+
+int
+perf_open (struct perf *const p)
+{
+	p->len = 0U;
+#ifdef __linux__
+	int e = ENOENT;
+	for (uint32_t i = 0U; i < PERF_EVENTS; ++i) {
+		int const fd = perf_event_open((enum perf_event)i,
+		                               p->len ? p->fd[0] : -1);
+		if (fd < 0) {
+			// Report why no leader could be opened
+			if (!p->len)
+				e = errno ? errno : EIO;
+			continue;
+		}
+		p->fd[p->len] = fd;
+		p->event[p->len++] = (uint8_t)i;
+	}
+
+	if (!p->len)
+		return e;
+
+	if (ioctl(p->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP)) {
+		e = errno ? errno : EIO;
+		perf_close(p);
+		return e;
+	}
+
+	return 0;
+#else
+	return ENOSYS;
+#endif
+}
+
+void
+perf_close (struct perf *const p)
+{
+#ifdef __linux__
+	// Members first, the group goes with the leader
+	while (p->len)
+		(void)close(p->fd[--p->len]);
+#endif
+	p->len = 0U;
+}
+
+void
+perf_read (struct perf const *const p,
+           struct perf_count *const c)
+{
+	*c = (struct perf_count){0};
+#ifdef __linux__
+	uint64_t buf[1U + PERF_EVENTS];
+	if (!p->len || read(p->fd[0], buf, sizeof buf) < 0)
+		return;
+
+	uint64_t const n = buf[0] < p->len ? buf[0] : p->len;
+	for (uint32_t i = 0U; i < n; ++i)
+		c->v[p->event[i]] = buf[1U + i];
+#else
+	(void)p;
+#endif
+}
@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file perf.h
+ * @brief Hardware performance counters of the calling thread
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_PERF_H_
+#define DBS26_SRC_PERF_H_
+
+#include "compat.h"
+
+#include <stdint.h>
+
+/*
+ * The counters are opened with perf_event_open() as one group, so that
+ * they are always scheduled onto the PMU together and can all be read
+ * with one system call. Only user space is counted, which is what an
+ * unprivileged process is allowed to count at the default setting of
+ * /proc/sys/kernel/perf_event_paranoid. Counters that the CPU doesn't
+ * have are left out of the group and read as zero. On other systems
+ * than Linux nothing can be opened.
+ */
+
+enum perf_event {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_BRANCH_MISSES,
+	PERF_L1D_MISSES, //!< L1 data cache read misses
+	PERF_EVENTS
+};
+
+/**
+ * @brief Counter values.
+ */
+struct perf_count {
+	uint64_t v[PERF_EVENTS];
+};
+
+/**
+ * @brief Open counters of a thread.
+ */
+struct perf {
+	int      fd[PERF_EVENTS];    //!< The group, leader first
+	uint8_t  event[PERF_EVENTS]; //!< Event of each counter in the group
+	uint32_t len;                //!< Number of counters, 0 if not open
+};
+
+/**
+ * @brief Start counting the calling thread.
+ *
+ * @param p Counters to open.
+ * @return  0 if at least one counter could be opened, otherwise an
+ *          error code. EACCES or EPERM mean a lack of permission, and
+ *          ENOENT or ENOSYS that there are no hardware counters.
+ */
+extern int
+perf_open (struct perf *p);
+
+/**
+ * @brief Close counters opened with perf_open(). Does nothing if they
+ *        aren't open.
+ */
+extern void
+perf_close (struct perf *p);
+
+/**
+ * @brief Read the current values of the counters.
+ *
+ * Values of counters that aren't open are set to zero.
+ */
+extern void
+perf_read (struct perf const *p,
+           struct perf_count *c);
+
+/**
+ * @brief Add the difference between two readings to @a sum.
+ */
+static force_inline void
+perf_add (struct perf_count *const       sum,
+          struct perf_count const *const from,
+          struct perf_count const *const to)
+{
+	for (uint32_t i = 0U; i < PERF_EVENTS; ++i)
+		sum->v[i] += to->v[i] - from->v[i];
+}
+
+#endif /* DBS26_SRC_PERF_H_ */
@@ -0,0 +1,359 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file query.c
+ * @brief Membership, rank and select queries on a sorted output file
+ * @author Juuso Alasuutari
+ */
+
+#include "compat.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#else
+# include <Windows.h>
+#endif
+
+#if defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+# include <immintrin.h>
+# define query_prefetch(p) _mm_prefetch((char const *)(p), _MM_HINT_T0)
+#elif defined __GNUC__
+# define query_prefetch(p) __builtin_prefetch(p)
+#else
+# define query_prefetch(p) ((void)(p))
+#endif
+
+#include "pack.h"
+#include "query.h"
+
+// Lookups in flight at a time in query_rank()
+#define QUERY_GROUP 16U
+
+#define QUERY_TOP_LEN ((size_t)1U << 16U)
+
+int
+query_map (struct query *const q,
+           char const *const   path)
+{
+#ifndef _WIN32
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return errno ? errno : EIO;
+
+	int e = 0;
+	struct stat st;
+	if (fstat(fd, &st)) {
+		e = errno ? errno : EIO;
+	} else if ((uint64_t)st.st_size > SIZE_MAX) {
+		e = EFBIG;
+	} else if (st.st_size > 0) {
+		void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ,
+		               MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			e = errno ? errno : EIO;
+		} else {
+			q->map = p;
+			q->size = (size_t)st.st_size;
+		}
+	}
+
+	(void)close(fd);
+	return e;
+#else
+	HANDLE h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (h == INVALID_HANDLE_VALUE)
+		return ENOENT;
+
+	int e = 0;
+	LARGE_INTEGER size = {0};
+	if (!GetFileSizeEx(h, &size)) {
+		e = EIO;
+	} else if ((uint64_t)size.QuadPart > SIZE_MAX) {
+		e = EFBIG;
+	} else if (size.QuadPart > 0) {
+		HANDLE m = CreateFileMappingA(h, nullptr, PAGE_READONLY,
+		                              0, 0, nullptr);
+		void *p = m ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (m)
+			CloseHandle(m);
+		if (!p) {
+			e = ENOMEM;
+		} else {
+			q->map = p;
+			q->size = (size_t)size.QuadPart;
+		}
+	}
+
+	CloseHandle(h);
+	return e;
+#endif
+}
+
+void
+query_unmap (struct query *const q)
+{
+	if (!q->map)
+		return;
+#ifndef _WIN32
+	(void)munmap(q->map, q->size);
+#else
+	(void)UnmapViewOfFile(q->map);
+#endif
+	q->map = nullptr;
+	q->size = 0U;
+}
+
+/**
+ * @brief Decode a whole packed file into memory.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+query_unpack (struct query *const q,
+              char const *const   path,
+              leaf_func_t *const  leaf)
+{
+	struct pack_file r;
+	int e = pack_open(&r, path, leaf);
+	if (e)
+		return e;
+
+	uint64_t const count = pack_count(&r);
+	if (count > SIZE_MAX / sizeof *q->heap) {
+		e = EFBIG;
+	} else if (count) {
+		q->heap = malloc((size_t)count * sizeof *q->heap);
+		if (!q->heap)
+			e = errno ? errno : ENOMEM;
+		else
+			e = pack_read(&r, q->heap, 0U, (size_t)count);
+	}
+
+	pack_close(&r);
+	if (!e) {
+		q->seq = q->heap;
+		q->len = (size_t)count;
+	}
+
+	return e;
+}
+
+/**
+ * @brief Sample every @ref QUERY_FAN th element of an array.
+ *
+ * @return The samples, or a null pointer if out of memory.
+ */
+static uint64_t *
+query_sample (uint64_t const *const src,
+              size_t const          len,
+              size_t *const         n)
+{
+	*n = (len + QUERY_FAN - 1U) / QUERY_FAN;
+	uint64_t *dst = malloc((*n ? *n : 1U) * sizeof *dst);
+	if (dst) {
+		for (size_t i = 0U; i < *n; ++i)
+			dst[i] = src[i * QUERY_FAN];
+	}
+	return dst;
+}
+
+/**
+ * @brief Check the order of the sequences and build the index.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+query_index (struct query *const q)
+{
+	for (size_t i = 1U; i < q->len; ++i) {
+		if (q->seq[i - 1U] >= q->seq[i])
+			return EBADMSG;
+	}
+
+	q->key1 = query_sample(q->seq, q->len, &q->len1);
+	if (q->key1)
+		q->key2 = query_sample(q->key1, q->len1, &q->len2);
+	q->top = malloc((QUERY_TOP_LEN + 1U) * sizeof *q->top);
+	if (!q->key1 || !q->key2 || !q->top)
+		return errno ? errno : ENOMEM;
+
+	for (size_t p = 0U, j = 0U; p <= QUERY_TOP_LEN; ++p) {
+		while (j < q->len2 && q->key2[j] >> 48U < p)
+			++j;
+		q->top[p] = (uint32_t)j;
+	}
+
+	return 0;
+}
+
+int
+query_open (struct query *const q,
+            char const *const   path,
+            leaf_func_t *const  leaf)
+{
+	*q = (struct query){0};
+
+	int e = query_map(q, path);
+	if (e)
+		return e;
+
+	if (q->size >= 8U && !memcmp(q->map, "DBS26PAK", 8U)) {
+		// The lowest byte of a sequence is odd, so this can't be raw
+		query_unmap(q);
+		e = query_unpack(q, path, leaf);
+	} else if (q->size % sizeof *q->seq) {
+		e = EBADMSG;
+	} else {
+		q->seq = q->map;
+		q->len = q->size / sizeof *q->seq;
+	}
+
+	if (!e && q->len > UINT32_MAX)
+		e = EFBIG;
+	if (!e)
+		e = query_index(q);
+	if (e)
+		query_close(q);
+
+	return e;
+}
+
+void
+query_close (struct query *const q)
+{
+	query_unmap(q);
+	free(q->heap);
+	free(q->key1);
+	free(q->key2);
+	free(q->top);
+	*q = (struct query){0};
+}
+
+/**
+ * @brief Count the elements of a sorted array that are less than @a v.
+ */
+static force_inline size_t
+lower_bound (uint64_t const *const a,
+             size_t                n,
+             uint64_t const        v)
+{
+	uint64_t const *b = a;
+	while (n > 1U) {
+		size_t const h = n / 2U;
+		b = b[h - 1U] < v ? &b[h] : b;
+		n -= h;
+	}
+	return (size_t)(b - a) + (n && *b < v);
+}
+
+/**
+ * @brief Count the elements of a sorted array that are at most @a v.
+ */
+static force_inline size_t
+upper_bound (uint64_t const *const a,
+             size_t                n,
+             uint64_t const        v)
+{
+	uint64_t const *b = a;
+	while (n > 1U) {
+		size_t const h = n / 2U;
+		b = b[h - 1U] <= v ? &b[h] : b;
+		n -= h;
+	}
+	return (size_t)(b - a) + (n && *b <= v);
+}
+
+/**
+ * @brief Prefetch @a n consecutive elements.
+ */
+static force_inline void
+query_fetch (uint64_t const *const a,
+             size_t const          n)
+{
+	for (size_t i = 0U; i < n; i += 8U)
+		query_prefetch(&a[i]);
+}
+
+/**
+ * @brief Get the length of a block of @ref QUERY_FAN elements.
+ *
+ * @param len Length of the array.
+ * @param b   Index of the block.
+ */
+static const_inline size_t
+query_block_len (size_t const len,
+                 size_t const b)
+{
+	size_t const n = len - b * QUERY_FAN;
+	return n < QUERY_FAN ? n : QUERY_FAN;
+}
+
+void
+query_rank (struct query const *const q,
+            uint64_t const *const     v,
+            uint64_t *const           rank,
+            size_t const              n)
+{
+	for (size_t k = 0U; k < n; k += QUERY_GROUP) {
+		size_t const m = n - k < QUERY_GROUP ? n - k : QUERY_GROUP;
+		size_t b[QUERY_GROUP];
+		bool in[QUERY_GROUP];
+
+		// The last element of key2 that is at most v, if any
+		for (size_t i = 0U; i < m; ++i) {
+			size_t const p = (size_t)(v[k + i] >> 48U);
+			size_t const a = q->top[p];
+			size_t const j = a + upper_bound(&q->key2[a],
+			                                 q->top[p + 1U] - a,
+			                                 v[k + i]);
+			in[i] = j > 0U;
+			if (in[i]) {
+				b[i] = j - 1U;
+				query_fetch(&q->key1[b[i] * QUERY_FAN],
+				            query_block_len(q->len1, b[i]));
+			}
+		}
+
+		// The same in the block of key1 under it
+		for (size_t i = 0U; i < m; ++i) {
+			if (in[i]) {
+				uint64_t const *const a = &q->key1[b[i] * QUERY_FAN];
+				b[i] = b[i] * QUERY_FAN - 1U
+				       + upper_bound(a, query_block_len(q->len1, b[i]),
+				                     v[k + i]);
+				query_fetch(&q->seq[b[i] * QUERY_FAN],
+				            query_block_len(q->len, b[i]));
+			}
+		}
+
+		// Then count the sequences less than v in the block under that
+		for (size_t i = 0U; i < m; ++i) {
+			size_t const s = b[i] * QUERY_FAN;
+			rank[k + i] = in[i]
+			              ? s + lower_bound(&q->seq[s],
+			                                query_block_len(q->len, b[i]),
+			                                v[k + i])
+			              : 0U;
+		}
+	}
+}
+
+void
+query_find (struct query const *const q,
+            uint64_t const *const     v,
+            uint64_t *const           idx,
+            size_t const              n)
+{
+	query_rank(q, v, idx, n);
+	for (size_t i = 0U; i < n; ++i)
+		if (idx[i] >= q->len || q->seq[idx[i]] != v[i])
+			idx[i] = UINT64_MAX;
+}
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file query.h
+ * @brief Membership, rank and select queries on a sorted output file
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_QUERY_H_
+#define DBS26_SRC_QUERY_H_
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "leaf.h"
+
+/*
+ * Every 64th sequence (@ref QUERY_FAN) is sampled into @a key1, and
+ * every 64th of those into @a key2, which is small enough to stay in
+ * cache. A table of the first entry of @a key2 for each 16-bit
+ * prefix narrows down where to search it, and from then on each level
+ * leaves a block of @ref QUERY_FAN keys or sequences to search in the
+ * next one. That makes for two blocks of 8 cache lines from memory per
+ * lookup, which query_rank() prefetches for several lookups at a time.
+ */
+
+#define QUERY_FAN 64U
+
+/**
+ * @brief A sorted output file opened for queries.
+ */
+struct query {
+	uint64_t const *seq;  //!< The sequences
+	size_t          len;  //!< Number of sequences
+	void           *map;  //!< Mapping of a raw file
+	size_t          size; //!< Size of @a map
+	uint64_t       *heap; //!< Decoded packed file
+	uint64_t       *key1; //!< Sampled sequences
+	uint64_t       *key2; //!< Sampled elements of @a key1
+	size_t          len1;
+	size_t          len2;
+	uint32_t       *top;  //!< First of @a key2 for each 16-bit prefix
+};
+
+/**
+ * @brief Map a whole file into memory for reading.
+ *
+ * Sets @a map and @a size of @a q, and leaves the rest alone. An empty
+ * file isn't mapped.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+query_map (struct query *q,
+           char const   *path);
+
+/**
+ * @brief Unmap a file mapped with query_map(), if it is.
+ */
+extern void
+query_unmap (struct query *q);
+
+/**
+ * @brief Open a raw or packed output file for queries.
+ *
+ * A raw file is mapped into memory, a packed one decoded into it.
+ * Either way the sequences are checked to be in strictly ascending
+ * order while the index is built.
+ *
+ * @param q    Query engine to initialize.
+ * @param path File name.
+ * @param leaf Leaf kernel for decoding a packed file, or a null pointer.
+ * @return     0 on success, otherwise an error code.
+ */
+extern int
+query_open (struct query *q,
+            char const   *path,
+            leaf_func_t  *leaf);
+
+/**
+ * @brief Close a file opened with query_open().
+ */
+extern void
+query_close (struct query *q);
+
+/**
+ * @brief Count the sequences less than each value.
+ *
+ * The lookups are done in small groups with the memory of each one
+ * prefetched while the others are being searched.
+ *
+ * @param q    Query engine.
+ * @param v    Values.
+ * @param rank Output array for the counts.
+ * @param n    Number of values.
+ */
+extern void
+query_rank (struct query const *q,
+            uint64_t const     *v,
+            uint64_t           *rank,
+            size_t              n);
+
+/**
+ * @brief Find the index of each value in the set.
+ *
+ * Like query_rank(), but writes UINT64_MAX for values that aren't in
+ * the set.
+ */
+extern void
+query_find (struct query const *q,
+            uint64_t const     *v,
+            uint64_t           *idx,
+            size_t              n);
+
+#endif /* DBS26_SRC_QUERY_H_ */
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file rng.h
+ * @brief Pseudorandom number generator for sampling
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_RNG_H_
+#define DBS26_SRC_RNG_H_
+
+#include "compat.h"
+
+#include <stdint.h>
+
+/**
+ * @brief xoshiro256** state.
+ *
+ * Each stream is seeded from a seed and a stream number with splitmix64,
+ * so that the same seed always gives the same streams no matter which
+ * thread draws from which one.
+ */
+struct rng {
+	uint64_t s[4];
+};
+
+static const_inline uint64_t
+rng_rotl (uint64_t const x,
+          uint32_t const k)
+{
+	return x << k | x >> (64U - k);
+}
+
+/** @brief Advance a splitmix64 state and get its next output.
+ */
+static force_inline uint64_t
+rng_splitmix (uint64_t *const x)
+{
+	uint64_t z = (*x += UINT64_C(0x9e3779b97f4a7c15));
+	z = (z ^ (z >> 30U)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27U)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31U);
+}
+
+/**
+ * @brief Seed stream @a stream of @a seed.
+ */
+static force_inline void
+rng_init (struct rng *const r,
+          uint64_t const    seed,
+          uint64_t const    stream)
+{
+	uint64_t x = seed;
+	x = rng_splitmix(&x) ^ stream;
+	for (uint32_t i = 0U; i < 4U; ++i)
+		r->s[i] = rng_splitmix(&x);
+}
+
+/** @brief Get the next 64 random bits.
+ */
+static force_inline uint64_t
+rng_next (struct rng *const r)
+{
+	uint64_t const x = rng_rotl(r->s[1] * 5U, 7U) * 9U;
+	uint64_t const t = r->s[1] << 17U;
+	r->s[2] ^= r->s[0];
+	r->s[3] ^= r->s[1];
+	r->s[1] ^= r->s[2];
+	r->s[0] ^= r->s[3];
+	r->s[2] ^= t;
+	r->s[3] = rng_rotl(r->s[3], 45U);
+	return x;
+}
+
+#endif /* DBS26_SRC_RNG_H_ */
@@ -0,0 +1,341 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file shard.c
+ * @brief Output of a part of the work, and merging such parts
+ * @author Juuso Alasuutari
+ */
+
+#include "compat.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+# include <sys/types.h>
+# include <unistd.h>
+#else
+# include <fcntl.h>
+# include <io.h>
+#endif
+
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+
+#include "shard.h"
+
+#define SHARD_VERSION 1U
+
+// Bytes per read() and write() when the data can't be copied directly
+#define SHARD_BUF_SIZE ((size_t)1U << 20U)
+
+static char const shard_magic[8] = {'D', 'B', 'S', '2', '6', 'S', 'H', 'D'};
+
+static force_inline uint64_t
+get64 (uint8_t const *const src)
+{
+	uint64_t x = 0U;
+	for (uint32_t i = 0U; i < 8U; ++i)
+		x |= (uint64_t)src[i] << (i * 8U);
+	return x;
+}
+
+static force_inline void
+put64 (uint8_t *const dst,
+       uint64_t const x)
+{
+	for (uint32_t i = 0U; i < 8U; ++i)
+		dst[i] = (uint8_t)(x >> (i * 8U));
+}
+
+int
+shard_write_head (FILE *const              f,
+                  struct shard const *const h)
+{
+	uint8_t b[SHARD_HEAD_SIZE] = {0};
+	(void)memcpy(b, shard_magic, sizeof shard_magic);
+	put64(&b[8], SHARD_VERSION);
+	put64(&b[16], h->run);
+	put64(&b[24], (uint64_t)h->tasks << 32U | h->order);
+	put64(&b[32], (uint64_t)h->count << 32U | h->index);
+	put64(&b[40], (uint64_t)h->end << 32U | h->first);
+	put64(&b[48], h->bytes);
+	put64(&b[56], h->done);
+
+	if (fwrite(b, 1U, sizeof b, f) != sizeof b)
+		return errno ? errno : EIO;
+
+	return 0;
+}
+
+int
+shard_read_head (FILE *const         f,
+                 struct shard *const h)
+{
+	uint8_t b[SHARD_HEAD_SIZE];
+	if (fread(b, 1U, sizeof b, f) != sizeof b)
+		return ferror(f) ? errno ? errno : EIO : EBADMSG;
+
+	if (memcmp(b, shard_magic, sizeof shard_magic) ||
+	    get64(&b[8]) != SHARD_VERSION)
+		return EBADMSG;
+
+	uint64_t const x = get64(&b[24]), y = get64(&b[32]), z = get64(&b[40]);
+	*h = (struct shard){
+		.run   = get64(&b[16]),
+		.order = (uint32_t)x,
+		.tasks = (uint32_t)(x >> 32U),
+		.index = (uint32_t)y,
+		.count = (uint32_t)(y >> 32U),
+		.first = (uint32_t)z,
+		.end   = (uint32_t)(z >> 32U),
+		.bytes = get64(&b[48]),
+		.done  = get64(&b[56]) == 1U,
+	};
+
+	return h->first > h->end || h->end > h->tasks ||
+	       !h->index || h->index > h->count ? EBADMSG : 0;
+}
+
+/**
+ * @brief An open shard file.
+ */
+struct shard_file {
+	char const  *path;
+	FILE        *f;
+	uint64_t     size;  //!< Of the output, without the header
+	struct shard head;
+};
+
+static int
+shard_file_cmp (void const *a,
+                void const *b)
+{
+	uint32_t const x = ((struct shard_file const *)a)->head.first;
+	uint32_t const y = ((struct shard_file const *)b)->head.first;
+	return (x > y) - (x < y);
+}
+
+static int
+shard_open (struct shard_file *const s,
+            char const *const        path)
+{
+	s->path = path;
+	s->f = fopen(path, "rb");
+	if (!s->f)
+		return errno ? errno : EIO;
+
+	int e = shard_read_head(s->f, &s->head);
+#ifndef _WIN32
+	off_t end = 0;
+	if (!e && (fseeko(s->f, 0, SEEK_END) || (end = ftello(s->f)) < 0))
+#else
+	__int64 end = 0;
+	if (!e && (_fseeki64(s->f, 0, SEEK_END) ||
+	           (end = _ftelli64(s->f)) < 0))
+#endif
+		e = errno ? errno : EIO;
+	if (!e && ((uint64_t)end - SHARD_HEAD_SIZE) % sizeof(uint64_t))
+		e = EBADMSG;
+	s->size = (uint64_t)end - SHARD_HEAD_SIZE;
+	return e;
+}
+
+/**
+ * @brief Copy @a len bytes from offset @a off of @a in to the end of
+ *        @a out.
+ *
+ * @param out  Output file.
+ * @param in   Input file.
+ * @param off  Offset in @a in.
+ * @param len  Number of bytes.
+ * @param fast Whether to try copy_file_range(), cleared if it can't be
+ *             used for these files.
+ * @param buf  Buffer of @ref SHARD_BUF_SIZE bytes, or a null pointer.
+ *             One is allocated when it's first needed.
+ * @return     0 on success, otherwise an error code.
+ */
+static int
+shard_copy (FILE      *out,
+            FILE      *in,
+            uint64_t   off,
+            uint64_t   len,
+            bool      *fast,
+            uint8_t  **buf)
+{
+#if defined __linux__ && defined SYS_copy_file_range
+	while (*fast && len) {
+		int64_t o = (int64_t)off;
+		size_t const n = len < SHARD_BUF_SIZE << 10U
+		                 ? (size_t)len : SHARD_BUF_SIZE << 10U;
+		ssize_t const r = (ssize_t)syscall(SYS_copy_file_range,
+		                                   fileno(in), &o, fileno(out),
+		                                   nullptr, n, 0U);
+		if (r > 0) {
+			off += (uint64_t)r;
+			len -= (uint64_t)r;
+		} else if (!r) {
+			return EBADMSG;
+		} else if (errno != EINTR) {
+			// Not between these files, fall back to copying
+			if (errno != EXDEV && errno != EINVAL &&
+			    errno != ENOSYS && errno != EOPNOTSUPP &&
+			    errno != EBADF)
+				return errno;
+			*fast = false;
+			(void)fseeko(out, 0, SEEK_END);
+		}
+	}
+#else
+	*fast = false;
+#endif
+
+	if (!len)
+		return 0;
+
+	if (!*buf && !(*buf = malloc(SHARD_BUF_SIZE)))
+		return errno ? errno : ENOMEM;
+
+#ifndef _WIN32
+	if (fseeko(in, (off_t)off, SEEK_SET))
+#else
+	if (_fseeki64(in, (__int64)off, SEEK_SET))
+#endif
+		return errno ? errno : EIO;
+
+	while (len) {
+		size_t const n = len < SHARD_BUF_SIZE ? (size_t)len
+		                                      : SHARD_BUF_SIZE;
+		if (fread(*buf, 1U, n, in) != n)
+			return ferror(in) ? errno ? errno : EIO : EBADMSG;
+		if (fwrite(*buf, 1U, n, out) != n)
+			return errno ? errno : EIO;
+		len -= n;
+	}
+
+	return 0;
+}
+
+int
+shard_merge (char const *const        out,
+             char const *const *const in,
+             size_t const             n)
+{
+	struct shard_file *s = calloc(n ? n : 1U, sizeof *s);
+	if (!s) {
+		int e = errno ? errno : ENOMEM;
+		perror("calloc");
+		return e;
+	}
+
+	int e = 0;
+	size_t i = 0U;
+	for (; !e && i < n; ++i) {
+		e = shard_open(&s[i], in[i]);
+		if (e)
+			(void)fprintf(stderr, "%s: %s\n", in[i], e == EBADMSG
+			              ? "not a shard file" : strerror(e));
+	}
+
+	// Every shard has to be of the same run
+	for (size_t j = 1U; !e && j < n; ++j) {
+		struct shard const *const a = &s[0].head, *const b = &s[j].head;
+		if (a->run != b->run || a->order != b->order ||
+		    a->tasks != b->tasks || a->count != b->count) {
+			e = EINVAL;
+			(void)fprintf(stderr, "%s and %s aren't of the same run\n",
+			              s[0].path, s[j].path);
+		}
+	}
+
+	// ...be complete, the size the header says...
+	for (size_t j = 0U; !e && j < n; ++j) {
+		struct shard const *const h = &s[j].head;
+		if (!h->done) {
+			e = EINVAL;
+			(void)fprintf(stderr, "%s is incomplete, the run that"
+			              " wrote it didn't finish\n", s[j].path);
+		} else if (h->bytes != s[j].size) {
+			e = EINVAL;
+			(void)fprintf(stderr, "%s has %" PRIu64 " bytes of output"
+			              " instead of %" PRIu64 "\n", s[j].path,
+			              s[j].size, h->bytes);
+		}
+	}
+
+	// ...and between them have every task once
+	qsort(s, i, sizeof *s, shard_file_cmp);
+	uint32_t next = 0U;
+	uint64_t size = 0U;
+	for (size_t j = 0U; !e && j < n; ++j) {
+		struct shard const *const h = &s[j].head;
+		if (h->first > next) {
+			e = EINVAL;
+			(void)fprintf(stderr, "Tasks %" PRIu32 " to %" PRIu32
+			              " are missing\n", next, h->first - 1U);
+		} else if (h->first < next) {
+			e = EINVAL;
+			(void)fprintf(stderr, "%s overlaps %s\n", s[j].path,
+			              s[j - 1U].path);
+		}
+		next = h->end;
+		size += s[j].size;
+	}
+	if (!e && n && next < s[0].head.tasks) {
+		e = EINVAL;
+		(void)fprintf(stderr, "Tasks %" PRIu32 " to %" PRIu32 " are"
+		              " missing\n", next, s[0].head.tasks - 1U);
+	}
+
+	bool const file = !(out[0] == '-' && !out[1]);
+	FILE *f = nullptr;
+	if (!e) {
+#ifdef _WIN32
+		if (!file) {
+			(void)fflush(stdout);
+			(void)_setmode(_fileno(stdout), _O_BINARY);
+		}
+#endif
+		f = file ? fopen(out, "wb") : stdout;
+		if (!f) {
+			e = errno ? errno : EIO;
+			perror("fopen");
+		}
+	}
+
+	bool fast = true;
+	uint8_t *buf = nullptr;
+	for (size_t j = 0U; !e && j < n; ++j) {
+		e = shard_copy(f, s[j].f, SHARD_HEAD_SIZE, s[j].size,
+		               &fast, &buf);
+		if (e)
+			(void)fprintf(stderr, "%s: %s\n", s[j].path, strerror(e));
+	}
+	free(buf);
+
+	if (f && file) {
+		if (fclose(f) && !e) {
+			e = errno ? errno : EIO;
+			perror("fclose");
+		}
+		if (e)
+			(void)remove(out);
+	} else if (f && fflush(f) && !e) {
+		e = errno ? errno : EIO;
+		perror("fflush");
+	}
+
+	if (!e)
+		(void)fprintf(stderr, "Merged %zu shards, %" PRIu64 " bytes%s\n",
+		              n, size, fast ? "" : ", by copying");
+
+	for (size_t j = 0U; j < i; ++j) {
+		if (s[j].f)
+			(void)fclose(s[j].f);
+	}
+	free(s);
+	return e;
+}
@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file shard.h
+ * @brief Output of a part of the work, and merging such parts
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_SHARD_H_
+#define DBS26_SRC_SHARD_H_
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * A shard file is a header followed by raw output. The header is little
+ * endian, and written again with the size of the output once all of it
+ * has been generated:
+ *
+ *   offset  size  contents
+ *        0     8  "DBS26SHD"
+ *        8     8  version
+ *       16     8  run, which identifies the task table that was shared
+ *       24     4  order
+ *       28     4  number of tasks in the whole run
+ *       32     4  shard number, from 1
+ *       36     4  number of shards
+ *       40     4  first task of the shard
+ *       44     4  one past the last task of the shard
+ *       48     8  size of the output in bytes, once complete
+ *       56     4  1 once complete, otherwise 0
+ *       60     4  zero
+ *
+ * The tasks of a shard are a contiguous run of the task table, so the
+ * output of the whole run is the output of the shards in order of their
+ * first task.
+ */
+
+#define SHARD_HEAD_SIZE 64U
+
+// Most shards a run can be split into
+#define SHARD_MAX 65536U
+
+/**
+ * @brief Header of a shard file.
+ */
+struct shard {
+	uint64_t run;
+	uint32_t order;
+	uint32_t tasks;  //!< In the whole run
+	uint32_t index;  //!< From 1
+	uint32_t count;
+	uint32_t first;
+	uint32_t end;
+	uint64_t bytes;  //!< Of the output, once @a done
+	bool     done;   //!< Whether the output is complete
+};
+
+/**
+ * @brief Write the header of a shard file.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+shard_write_head (FILE               *f,
+                  struct shard const *h);
+
+/**
+ * @brief Read the header of a shard file.
+ *
+ * @return 0 on success, EBADMSG if the file isn't a shard file,
+ *         otherwise an error code.
+ */
+extern int
+shard_read_head (FILE         *f,
+                 struct shard *h);
+
+/**
+ * @brief Concatenate the output of shard files in order.
+ *
+ * The shards can be given in any order, but they have to be complete,
+ * be from the same run and together have every task of it exactly
+ * once. On Linux the output is copied from file to file with
+ * copy_file_range(), which can share the data blocks instead of copying
+ * them on file systems that support it, and otherwise with read() and
+ * write().
+ *
+ * @param out Output file name, or a dash for standard output.
+ * @param in  Shard file names.
+ * @param n   Number of shard files.
+ * @return    0 on success, otherwise an error code.
+ */
+extern int
+shard_merge (char const        *out,
+             char const *const *in,
+             size_t             n);
+
+#endif /* DBS26_SRC_SHARD_H_ */
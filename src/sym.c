@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file sym.c
+ * @brief Complement symmetry of order 6 sequences
+ * @author Juuso Alasuutari
+ */
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sym.h"
+
+void
+u64_sort (uint64_t *const v,
+          uint64_t *const tmp,
+          size_t const    n)
+{
+	uint64_t *src = v, *dst = tmp;
+
+	// Least significant digit first radix sort, one byte at a time.
+	// Bytes that are the same in every integer are skipped.
+	for (uint32_t s = 0U; n && s < 64U; s += 8U) {
+		size_t cnt[256] = {0};
+		for (size_t i = 0U; i < n; ++i)
+			cnt[(src[i] >> s) & 255U]++;
+		if (cnt[(src[0] >> s) & 255U] == n)
+			continue;
+
+		for (size_t i = 0U, sum = 0U; i < 256U; ++i) {
+			size_t c = cnt[i];
+			cnt[i] = sum;
+			sum += c;
+		}
+		for (size_t i = 0U; i < n; ++i)
+			dst[cnt[(src[i] >> s) & 255U]++] = src[i];
+
+		uint64_t *t = src;
+		src = dst;
+		dst = t;
+	}
+
+	if (src != v)
+		(void)memcpy(v, src, n * sizeof *v);
+}
+
+void
+u64_merge (uint64_t *const       dst,
+           size_t                n,
+           uint64_t const *const src,
+           size_t                m)
+{
+	// Fill from the end so that nothing is overwritten before use
+	while (m) {
+		if (n && dst[n - 1U] > src[m - 1U]) {
+			dst[n + m - 1U] = dst[n - 1U];
+			--n;
+		} else {
+			dst[n + m - 1U] = src[m - 1U];
+			--m;
+		}
+	}
+}
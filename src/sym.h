@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file sym.h
+ * @brief Complement symmetry of order 6 sequences
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_SYM_H_
+#define DBS26_SRC_SYM_H_
+
+#include "compat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bits.h"
+
+/*
+ * The complement of a De Bruijn sequence is one too. Every sequence is
+ * output rotated so that it begins with its all-zeros window, and the
+ * all-ones window of the sequence starts at some bit offset p, counting
+ * from the most significant bit. In the complement the two swap places,
+ * so when rotated back to begin with all zeros, its all-ones window is
+ * at offset 64 - p. Reversing the bits has the same effect on p, so it
+ * can't reduce the search any further on its own.
+ */
+
+/** @brief Get the offset of the all-ones window of a sequence.
+ *
+ * @param seq A sequence that begins with its all-zeros window.
+ * @return    Bit offset from the most significant bit.
+ */
+static const_inline uint32_t
+sym_ones (uint64_t const seq)
+{
+	// The run of ones can't wrap around, the sequence begins with 0
+	uint64_t x = seq & seq << 1U;
+	x &= x << 2U;
+	x &= x << 2U;
+	return count_msb_1(~x);
+}
+
+/** @brief Get the complement of a sequence.
+ *
+ * @param seq  A sequence that begins with its all-zeros window.
+ * @param ones The offset of its all-ones window, see sym_ones().
+ * @return     The complement, rotated to begin with all zeros.
+ */
+static const_inline uint64_t
+sym_complement (uint64_t const seq,
+                uint32_t const ones)
+{
+	return ~(seq << ones | seq >> (64U - ones));
+}
+
+/**
+ * @brief Sort an array of 64-bit integers in ascending order.
+ *
+ * @param v   Array to sort.
+ * @param tmp Scratch space for @a n integers.
+ * @param n   Length of @a v.
+ */
+extern void
+u64_sort (uint64_t *v,
+          uint64_t *tmp,
+          size_t    n);
+
+/**
+ * @brief Merge a sorted array into another one in place.
+ *
+ * @param dst Sorted array of @a n integers with room for @a m more.
+ * @param n   Length of @a dst.
+ * @param src Sorted array to merge into @a dst.
+ * @param m   Length of @a src.
+ */
+extern void
+u64_merge (uint64_t       *dst,
+           size_t          n,
+           uint64_t const *src,
+           size_t          m);
+
+#endif /* DBS26_SRC_SYM_H_ */
@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file sync.h
+ * @brief Mutex and condition variable wrappers
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_SYNC_H_
+#define DBS26_SRC_SYNC_H_
+
+#include "compat.h"
+
+#ifndef _WIN32
+# include <pthread.h>
+#else
+# include <Windows.h>
+#endif
+
+/** @brief A mutex paired with a single condition variable.
+ *
+ * Every waiter re-checks its own predicate, so one condition variable
+ * and broadcast wakeups are enough for the few waiters we ever have.
+ */
+struct lock {
+#ifndef _WIN32
+	pthread_mutex_t    mtx;
+	pthread_cond_t     cnd;
+#else
+	SRWLOCK            mtx;
+	CONDITION_VARIABLE cnd;
+#endif
+};
+
+static inline int
+lock_init (struct lock *const l)
+{
+#ifndef _WIN32
+	int e = pthread_mutex_init(&l->mtx, nullptr);
+	if (!e) {
+		e = pthread_cond_init(&l->cnd, nullptr);
+		if (e)
+			(void)pthread_mutex_destroy(&l->mtx);
+	}
+	return e;
+#else
+	InitializeSRWLock(&l->mtx);
+	InitializeConditionVariable(&l->cnd);
+	return 0;
+#endif
+}
+
+static inline void
+lock_fini (struct lock *const l)
+{
+#ifndef _WIN32
+	(void)pthread_cond_destroy(&l->cnd);
+	(void)pthread_mutex_destroy(&l->mtx);
+#else
+	(void)l;
+#endif
+}
+
+static force_inline void
+lock_acquire (struct lock *const l)
+{
+#ifndef _WIN32
+	(void)pthread_mutex_lock(&l->mtx);
+#else
+	AcquireSRWLockExclusive(&l->mtx);
+#endif
+}
+
+static force_inline void
+lock_release (struct lock *const l)
+{
+#ifndef _WIN32
+	(void)pthread_mutex_unlock(&l->mtx);
+#else
+	ReleaseSRWLockExclusive(&l->mtx);
+#endif
+}
+
+/** @brief Atomically release the lock and sleep until woken up.
+ *
+ * @note Must be called with the lock held, and returns with it held.
+ *       Spurious wakeups are possible.
+ */
+static force_inline void
+lock_wait (struct lock *const l)
+{
+#ifndef _WIN32
+	(void)pthread_cond_wait(&l->cnd, &l->mtx);
+#else
+	(void)SleepConditionVariableSRW(&l->cnd, &l->mtx, INFINITE, 0);
+#endif
+}
+
+static force_inline void
+lock_wake (struct lock *const l)
+{
+#ifndef _WIN32
+	(void)pthread_cond_broadcast(&l->cnd);
+#else
+	WakeAllConditionVariable(&l->cnd);
+#endif
+}
+
+#endif /* DBS26_SRC_SYNC_H_ */
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file trace.h
+ * @brief Per-thread event log for --trace
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_TRACE_H_
+#define DBS26_SRC_TRACE_H_
+
+#include "compat.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** @brief Capacity of the log of each thread, a power of two. */
+#define TRACE_LEN (1U << 16U)
+
+enum trace_kind {
+	TRACE_THREAD, //!< Lifetime of a worker thread
+	TRACE_IDLE,   //!< Worker waiting for a piece to search
+	TRACE_PIECE,  //!< Worker searching a piece of a task
+	TRACE_FINISH, //!< Worker deriving or packing a searched task
+	TRACE_ALLOC,  //!< Allocating an output buffer
+	TRACE_START,  //!< Starting the worker threads
+	TRACE_WRITE,  //!< Writing out the output of a task
+	TRACE_JOIN,   //!< Joining the worker threads
+};
+
+/**
+ * @brief A span of time on one thread.
+ */
+struct trace_event {
+	double   begin; //!< Milliseconds, see clock_ms()
+	double   end;
+	uint64_t arg;   //!< Prefix of the task, or a size in bytes
+	uint32_t id;    //!< Task, or UINT32_MAX
+	uint8_t  kind;  //!< See @ref trace_kind
+	uint8_t  bits;  //!< Length of the prefix in @a arg
+	bool     split; //!< Whether the piece was split off from another
+};
+
+/**
+ * @brief Event log of one thread.
+ *
+ * Every thread only writes to its own log, so recording an event takes
+ * no locks or atomics. When the log is full the oldest events are
+ * overwritten, and @a len keeps counting so that the number of lost
+ * events is known.
+ */
+struct trace {
+	struct trace_event *ev;  //!< @ref TRACE_LEN events, or null if off
+	uint64_t            len; //!< Number of events recorded
+};
+
+/**
+ * @brief Allocate the log of a thread.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+static inline int
+trace_init (struct trace *const t)
+{
+	t->len = 0U;
+	t->ev = malloc(TRACE_LEN * sizeof *t->ev);
+	return t->ev ? 0 : errno ? errno : ENOMEM;
+}
+
+static inline void
+trace_free (struct trace *const t)
+{
+	free(t->ev);
+	t->ev = nullptr;
+	t->len = 0U;
+}
+
+/**
+ * @brief Record an event. Does nothing if the log isn't allocated.
+ */
+static force_inline void
+trace_add (struct trace *const t,
+           struct trace_event  ev)
+{
+	if (t->ev)
+		t->ev[t->len++ & (TRACE_LEN - 1U)] = ev;
+}
+
+/**
+ * @brief Get the index of the oldest event still in the log.
+ */
+static force_inline uint64_t
+trace_first (struct trace const *const t)
+{
+	return t->len > TRACE_LEN ? t->len - TRACE_LEN : 0U;
+}
+
+#endif /* DBS26_SRC_TRACE_H_ */
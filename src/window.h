@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file window.h
+ * @brief Branch-free 6-bit window uniqueness checks
+ * @author Juuso Alasuutari
+ */
+#ifndef DBS26_SRC_WINDOW_H_
+#define DBS26_SRC_WINDOW_H_
+
+#include "compat.h"
+
+#include <stdint.h>
+
+#include "bits.h"
+
+/** @brief Get the one-hot masks of the lowest @a num windows of @a seq
+ *         ORed together.
+ *
+ * The window at offset @a i is bits `i` to `i + 5` of @a seq.
+ */
+static const_inline uint64_t
+window_bits (uint64_t const seq,
+             uint32_t const num)
+{
+	uint64_t r = 0U;
+	for (uint32_t i = 0U; i < num; ++i)
+		r |= UINT64_C(1) << ((seq >> i) & 63U);
+	return r;
+}
+
+/** @brief Find the 6-bit extensions of @a seq that only add new windows.
+ *
+ * The windows that appending 6 bits to @a seq creates are fixed one bit
+ * at a time, most significant bit first, so this walks the binary tree
+ * of extensions depth first and prunes a branch at its first window
+ * that is already in @a map or earlier on the same path.
+ *
+ * @param seq Sequence to extend. Only its lowest 5 bits matter.
+ * @param map Windows used by @a seq.
+ * @return    A mask with bit `x` set for every valid extension `x`.
+ */
+static const_inline uint64_t
+window_ext (uint64_t const seq,
+            uint64_t const map)
+{
+	uint64_t m[6];
+	uint64_t r = 0U;
+	uint64_t v = seq << 1U; // Path so far, lowest bit the one being tried
+	uint32_t d = 0U;        // Number of bits fixed before the lowest one
+
+	for (m[0] = map;;) {
+		uint64_t const b = UINT64_C(1) << (v & 63U);
+		if (!(m[d] & b)) {
+			if (d == 5U) {
+				r |= b;
+			} else {
+				m[d + 1U] = m[d] | b;
+				v <<= 1U;
+				++d;
+				continue;
+			}
+		}
+
+		for (; v & 1U; v >>= 1U) {
+			if (!d--)
+				return r;
+		}
+		v |= 1U;
+	}
+}
+
+#endif /* DBS26_SRC_WINDOW_H_ */